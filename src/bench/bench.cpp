@@ -0,0 +1,104 @@
+#include "../pipes/pipes.h"
+#include "perf.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace pipes;
+
+// Runs every operation on a fresh pipe of n elements per element type and
+// prints, per element, time, cycles, instructions, IPC and cache and
+// branch misses. Each row is the fastest of `reps` runs.
+//
+//   ./bench [n] [reps]
+
+namespace {
+  volatile size_t sink {};
+
+  template <typename S>
+  std::vector<S> generate(size_t n);
+
+  template <>
+  std::vector<int> generate<int>(size_t n) {
+    std::mt19937 random {42};
+    std::vector<int> result(n);
+    for (int& i : result) i = static_cast<int>(random() % (n + 1));
+    return result;
+  }
+
+  template <>
+  std::vector<double> generate<double>(size_t n) {
+    std::mt19937 random {42};
+    std::uniform_real_distribution<double> uniform {0, 1};
+    std::vector<double> result(n);
+    for (double& d : result) d = uniform(random);
+    return result;
+  }
+
+  template <>
+  std::vector<std::string> generate<std::string>(size_t n) {
+    std::vector<std::string> result {};
+    for (int i : generate<int>(n)) result.push_back("event-" + std::to_string(i));
+    return result;
+  }
+
+  size_t weight(int i) { return i; }
+  size_t weight(double d) { return static_cast<size_t>(d * 1e6); }
+  size_t weight(const std::string& s) { return s.size() + s.back(); }
+
+  int key(int i) { return i % 1024; }
+  int key(double d) { return static_cast<int>(d * 1024); }
+  std::string key(const std::string& s) { return s.substr(0, 8); }
+
+  template <typename S, typename F>
+  void measure(PerfCounters& counters, const char* op, const char* type, const std::vector<S>& input, unsigned reps, F run) {
+    Counters best {};
+    for (unsigned r {}; r!=reps; r++) {
+      Pipe<S> pipe {input};
+      counters.start();
+      sink = sink + run(pipe);
+      Counters c {counters.stop()};
+      if (!r || c.nanos < best.nanos) best = c;
+    }
+    double n = input.size();
+    std::printf("%-10s %-8s %10.2f", op, type, best.nanos / n);
+    if (best.hardware) {
+      std::printf(" %10.2f %10.2f %6.2f %10.4f %10.4f\n", best.cycles / n, best.instructions / n,
+        best.cycles ? double(best.instructions) / best.cycles : 0.0, best.cacheMisses / n, best.branchMisses / n);
+    } else {
+      std::printf(" %10s %10s %6s %10s %10s\n", "n/a", "n/a", "n/a", "n/a", "n/a");
+    }
+  }
+
+  template <typename S>
+  void suite(PerfCounters& counters, const char* type, size_t n, unsigned reps) {
+    std::vector<S> input {generate<S>(n)};
+    using K = decltype(key(std::declval<const S&>()));
+    measure(counters, "map", type, input, reps, [](Pipe<S>& p){ return p.template map<S>([](const S& s){ return s; }).size(); });
+    measure(counters, "filter", type, input, reps, [](Pipe<S>& p){ return p.filter([](const S& s){ return weight(s) % 2 == 0; }).size(); });
+    measure(counters, "sort", type, input, reps, [](Pipe<S>& p){ return p.sort().size(); });
+    measure(counters, "collect", type, input, reps, [](Pipe<S>& p){ return p.collect(size_t {}, [](size_t z, const S& s){ return z + weight(s); }); });
+    measure(counters, "find", type, input, reps, [](Pipe<S>& p){ return size_t(p.exists([](const S& s){ return weight(s) == SIZE_MAX; })); });
+    measure(counters, "groupBy", type, input, reps, [](Pipe<S>& p){ return p.template groupBy<K>([](const S& s){ return key(s); }).size(); });
+    measure(counters, "join", type, input, reps, [](Pipe<S>& p){ return p.join(",").size(); });
+    measure(counters, "toSet", type, input, reps, [](Pipe<S>& p){ return p.toSet().size(); });
+    measure(counters, "distinct", type, input, reps, [](Pipe<S>& p){ return p.distinct().size(); });
+    measure(counters, "max", type, input, reps, [](Pipe<S>& p){
+      std::optional<S> max {p.max()};
+      return max ? weight(*max) : 0;
+    });
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  unsigned reps = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+  PerfCounters counters {};
+  if (!counters.available()) std::fprintf(stderr, "hardware counters unavailable, reporting wall time only\n");
+  std::printf("%-10s %-8s %10s %10s %10s %6s %10s %10s\n", "op", "type", "ns/elem", "cyc/elem", "ins/elem", "IPC", "llc/elem", "br/elem");
+  suite<int>(counters, "int", n, reps);
+  suite<double>(counters, "double", n, reps);
+  suite<std::string>(counters, "string", n, reps);
+  return 0;
+}
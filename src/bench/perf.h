@@ -0,0 +1,86 @@
+#ifndef PIPES_BENCH_PERF_H
+#define PIPES_BENCH_PERF_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace pipes {
+  struct Counters {
+    double nanos {};
+    uint64_t cycles {};
+    uint64_t instructions {};
+    uint64_t cacheMisses {};
+    uint64_t branchMisses {};
+    bool hardware {};
+  };
+
+  // Cycles, instructions, cache misses and branch misses of the calling
+  // thread, opened as one perf_event_open group so all four cover the same
+  // interval. Where the kernel or a VM does not expose them, only wall
+  // time is reported.
+  class PerfCounters {
+    static constexpr uint64_t events[] {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    static constexpr size_t count {sizeof events / sizeof events[0]};
+    std::vector<int> fds {};
+    std::chrono::steady_clock::time_point started {};
+    static int open(uint64_t event, int group) {
+      perf_event_attr attr {};
+      attr.size = sizeof attr;
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = event;
+      attr.disabled = group < 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+    }
+  public:
+    PerfCounters() {
+      for (uint64_t event : events) {
+        int fd {open(event, fds.empty() ? -1 : fds[0])};
+        if (fd < 0) {
+          for (int opened : fds) ::close(opened);
+          fds.clear();
+          return;
+        }
+        fds.push_back(fd);
+      }
+    }
+    PerfCounters(const PerfCounters&) = delete;
+    ~PerfCounters() {
+      for (int fd : fds) ::close(fd);
+    }
+    bool available() const { return !fds.empty(); }
+    void start() {
+      if (available()) {
+        ::ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+      }
+      started = std::chrono::steady_clock::now();
+    }
+    Counters stop() {
+      Counters result {};
+      result.nanos = std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now() - started).count();
+      if (!available()) return result;
+      ::ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+      uint64_t values[1 + count] {};
+      if (::read(fds[0], values, sizeof values) != sizeof values || values[0] != count) return result;
+      result.cycles = values[1];
+      result.instructions = values[2];
+      result.cacheMisses = values[3];
+      result.branchMisses = values[4];
+      result.hardware = true;
+      return result;
+    }
+  };
+}
+
+#endif
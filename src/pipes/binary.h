@@ -0,0 +1,201 @@
+#ifndef PIPES_BINARY_H
+#define PIPES_BINARY_H
+
+#include "pipes.h"
+#include "codec.h"
+
+#include <fstream>
+#include <cstring>
+
+namespace pipes {
+  template <typename T, typename = void>
+  struct HasLess : std::false_type {};
+  template <typename T>
+  struct HasLess<T, std::void_t<decltype(std::declval<const T&>() < std::declval<const T&>())>> : std::true_type {};
+
+  template <typename T>
+  struct ChunkInfo {
+    uint64_t offset {};
+    uint64_t bytes {};
+    uint64_t count {};
+    std::optional<T> min {};
+    std::optional<T> max {};
+  };
+
+  // File layout: "PIPE" version | chunk payloads | index | index offset "PEND".
+  // Each chunk is encoded on its own so it can be decoded without the others;
+  // the index holds every chunk's offset, size, count and min/max.
+  namespace binary {
+    constexpr char magic[4] {'P', 'I', 'P', 'E'};
+    constexpr char endMagic[4] {'P', 'E', 'N', 'D'};
+    constexpr uint8_t version {1};
+  }
+
+  template <typename T, bool Stats = HasLess<T>::value>
+  class BinaryWriter {
+    std::ofstream out;
+    size_t chunkSize;
+    uint64_t offset {};
+    std::vector<T> pending {};
+    std::vector<ChunkInfo<T>> index {};
+    void write(const void* data, size_t n) {
+      out.write(static_cast<const char*>(data), n);
+      if (!out) throw std::runtime_error {"pipes: write failed"};
+      offset += n;
+    }
+    void flush() {
+      if (pending.empty()) return;
+      ByteWriter chunk {};
+      writeRun(chunk, pending.data(), pending.size());
+      ChunkInfo<T> info {offset, chunk.bytes.size(), pending.size()};
+      if constexpr (Stats) {
+        auto [min, max] = std::minmax_element(pending.begin(), pending.end());
+        info.min = *min;
+        info.max = *max;
+      }
+      write(chunk.bytes.data(), chunk.bytes.size());
+      index.push_back(std::move(info));
+      pending.clear();
+    }
+  public:
+    BinaryWriter(const std::string& path, size_t chunkSize = 1 << 16)
+      : out {path, std::ios::binary | std::ios::trunc}, chunkSize {std::max<size_t>(chunkSize, 1)} {
+      if (!out) throw std::runtime_error {"pipes: cannot open " + path};
+      pending.reserve(this->chunkSize);
+      write(binary::magic, sizeof binary::magic);
+      write(&binary::version, 1);
+    }
+    BinaryWriter(const BinaryWriter&) = delete;
+    ~BinaryWriter() {
+      try {
+        close();
+      } catch (...) {
+      }
+    }
+    void add(const T& t) {
+      pending.push_back(t);
+      if (pending.size() == chunkSize) flush();
+    }
+    void close() {
+      if (!out.is_open()) return;
+      flush();
+      ByteWriter footer {};
+      footer.varint(index.size());
+      for (auto& info : index) {
+        footer.varint(info.offset);
+        footer.varint(info.bytes);
+        footer.varint(info.count);
+        footer.varint(info.min.has_value());
+        if (info.min) {
+          Codec<T>::write(footer, *info.min);
+          Codec<T>::write(footer, *info.max);
+        }
+      }
+      uint64_t footerOffset {offset};
+      write(footer.bytes.data(), footer.bytes.size());
+      write(&footerOffset, sizeof footerOffset);
+      write(binary::endMagic, sizeof binary::endMagic);
+      out.close();
+    }
+  };
+
+  template <typename T>
+  class BinaryFile {
+    std::string path;
+    std::vector<ChunkInfo<T>> index {};
+    static std::vector<char> readAt(std::ifstream& in, uint64_t offset, uint64_t n) {
+      std::vector<char> bytes(n);
+      in.seekg(offset);
+      in.read(bytes.data(), n);
+      if (!in) throw std::runtime_error {"pipes: read failed"};
+      return bytes;
+    }
+  public:
+    BinaryFile(const std::string& path) : path {path} {
+      std::ifstream in {path, std::ios::binary | std::ios::ate};
+      if (!in) throw std::runtime_error {"pipes: cannot open " + path};
+      uint64_t end = in.tellg();
+      size_t trailer {sizeof(uint64_t) + sizeof binary::endMagic};
+      if (end < sizeof binary::magic + 1 + trailer) throw std::runtime_error {"pipes: not a pipes binary file"};
+      std::vector<char> head {readAt(in, 0, sizeof binary::magic + 1)};
+      std::vector<char> tail {readAt(in, end - trailer, trailer)};
+      if (std::memcmp(head.data(), binary::magic, sizeof binary::magic) || head[4] != binary::version
+          || std::memcmp(tail.data() + sizeof(uint64_t), binary::endMagic, sizeof binary::endMagic)) {
+        throw std::runtime_error {"pipes: not a pipes binary file"};
+      }
+      uint64_t footerOffset;
+      std::memcpy(&footerOffset, tail.data(), sizeof footerOffset);
+      if (footerOffset > end - trailer) throw std::runtime_error {"pipes: corrupt index"};
+      std::vector<char> footer {readAt(in, footerOffset, end - trailer - footerOffset)};
+      ByteReader reader {footer.data(), footer.size()};
+      for (size_t n = reader.varint(); n; n--) {
+        ChunkInfo<T> info {};
+        info.offset = reader.varint();
+        info.bytes = reader.varint();
+        info.count = reader.varint();
+        if (reader.varint()) {
+          info.min = Codec<T>::read(reader);
+          info.max = Codec<T>::read(reader);
+        }
+        index.push_back(std::move(info));
+      }
+    }
+    size_t chunkCount() const { return index.size(); }
+    const ChunkInfo<T>& chunk(size_t i) const { return index.at(i); }
+    size_t size() const {
+      size_t total {};
+      for (auto& info : index) total += info.count;
+      return total;
+    }
+    void readChunk(size_t i, std::vector<T>& result) const {
+      const ChunkInfo<T>& info {index.at(i)};
+      std::ifstream in {path, std::ios::binary};
+      std::vector<char> bytes {readAt(in, info.offset, info.bytes)};
+      ByteReader reader {bytes.data(), bytes.size()};
+      readRun(reader, info.count, result);
+    }
+    std::vector<T> readChunk(size_t i) const {
+      std::vector<T> result {};
+      readChunk(i, result);
+      return result;
+    }
+    template <typename P>
+    Pipe<T> read(P chunkMayMatch, unsigned threads = 1) const {
+      std::vector<size_t> wanted {};
+      size_t total {};
+      for (size_t i {}; i!=index.size(); i++) {
+        if (index[i].min && !chunkMayMatch(*index[i].min, *index[i].max)) continue;
+        wanted.push_back(i);
+        total += index[i].count;
+      }
+      std::vector<std::vector<T>> parts(wanted.size());
+      runParallel(wanted.size(), threads, [&](size_t i){ readChunk(wanted[i], parts[i]); });
+      std::vector<T> result {};
+      if (parts.size() == 1) {
+        result = std::move(parts[0]);
+      } else {
+        result.reserve(total);
+        for (auto& part : parts) {
+          result.insert(result.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+        }
+      }
+      return Pipe<T> {std::move(result)};
+    }
+    Pipe<T> readAll(unsigned threads = 1) const {
+      return read([](const T&, const T&){ return true; }, threads);
+    }
+    Pipe<T> readBetween(const T& low, const T& high, unsigned threads = 1) const {
+      return read([&](const T& min, const T& max){ return !(max < low) && !(high < min); }, threads)
+        .filter([&](const T& t){ return !(t < low) && !(high < t); });
+    }
+  };
+
+  template <typename S>
+  void writeBinary(Pipe<S>& pipe, const std::string& path, size_t chunkSize = 1 << 16) {
+    BinaryWriter<S> writer {path, chunkSize};
+    pipe.forEach([&writer](const S& s){ writer.add(s); });
+    writer.close();
+  }
+}
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef PIPES_CODEC_H
+#define PIPES_CODEC_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+
+#include "sketches.h"
+
+namespace pipes {
+  struct ByteWriter {
+    std::vector<char> bytes {};
+    void put(const void* data, size_t n) {
+      const char* p = static_cast<const char*>(data);
+      bytes.insert(bytes.end(), p, p + n);
+    }
+    void varint(uint64_t v) {
+      while (v >= 0x80) {
+        bytes.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+      }
+      bytes.push_back(static_cast<char>(v));
+    }
+  };
+
+  struct ByteReader {
+    const char* data;
+    size_t size;
+    size_t pos {};
+    void get(void* out, size_t n) {
+      if (n > size - pos) throw std::runtime_error {"pipes: truncated data"};
+      std::memcpy(out, data + pos, n);
+      pos += n;
+    }
+    uint64_t varint() {
+      uint64_t v {};
+      for (int shift {}; shift < 64; shift += 7) {
+        if (pos == size) throw std::runtime_error {"pipes: truncated data"};
+        uint8_t b = data[pos++];
+        v |= uint64_t {b & 0x7fu} << shift;
+        if (!(b & 0x80)) return v;
+      }
+      throw std::runtime_error {"pipes: malformed varint"};
+    }
+    size_t remaining() const { return size - pos; }
+    bool done() const { return pos == size; }
+  };
+
+  inline uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+  inline int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+  template <typename T>
+  constexpr bool isVarint = std::is_integral_v<T> && !std::is_same_v<T,bool>;
+
+  template <typename T>
+  struct Codec {
+    static_assert(std::is_trivially_copyable_v<T>, "pipes: no Codec for this type");
+    static void write(ByteWriter& out, const T& t) {
+      if constexpr (isVarint<T>) {
+        out.varint(zigzag(static_cast<int64_t>(t)));
+      } else {
+        out.put(&t, sizeof t);
+      }
+    }
+    static T read(ByteReader& in) {
+      T t;
+      if constexpr (isVarint<T>) {
+        t = static_cast<T>(unzigzag(in.varint()));
+      } else {
+        in.get(&t, sizeof t);
+      }
+      return t;
+    }
+  };
+
+  // Integers are delta and zigzag encoded from the start of each run,
+  // other trivially copyable types are copied in bulk.
+  template <typename T>
+  void writeRun(ByteWriter& out, const T* items, size_t n) {
+    if constexpr (isVarint<T>) {
+      uint64_t prev {};
+      for (size_t i {}; i!=n; i++) {
+        uint64_t v = static_cast<int64_t>(items[i]);
+        out.varint(zigzag(static_cast<int64_t>(v - prev)));
+        prev = v;
+      }
+    } else if constexpr (std::is_trivially_copyable_v<T>) {
+      out.put(items, n * sizeof(T));
+    } else {
+      for (size_t i {}; i!=n; i++) Codec<T>::write(out, items[i]);
+    }
+  }
+
+  template <typename T>
+  void readRun(ByteReader& in, size_t n, std::vector<T>& result) {
+    if (n > in.remaining()) throw std::runtime_error {"pipes: truncated data"};
+    if constexpr (isVarint<T>) {
+      result.reserve(result.size() + n);
+      uint64_t prev {};
+      for (size_t i {}; i!=n; i++) {
+        prev += static_cast<uint64_t>(unzigzag(in.varint()));
+        result.push_back(static_cast<T>(prev));
+      }
+    } else if constexpr (std::is_trivially_copyable_v<T>) {
+      if (n > in.remaining() / sizeof(T)) throw std::runtime_error {"pipes: truncated data"};
+      size_t start {result.size()};
+      result.resize(start + n);
+      in.get(result.data() + start, n * sizeof(T));
+    } else {
+      result.reserve(result.size() + n);
+      for (size_t i {}; i!=n; i++) result.push_back(Codec<T>::read(in));
+    }
+  }
+
+  template <>
+  struct Codec<std::string> {
+    static void write(ByteWriter& out, const std::string& s) {
+      out.varint(s.size());
+      out.put(s.data(), s.size());
+    }
+    static std::string read(ByteReader& in) {
+      size_t n = in.varint();
+      if (n > in.remaining()) throw std::runtime_error {"pipes: truncated data"};
+      std::string s(n, '\0');
+      in.get(s.data(), s.size());
+      return s;
+    }
+  };
+
+  template <typename A, typename B>
+  struct Codec<std::pair<A,B>> {
+    static void write(ByteWriter& out, const std::pair<A,B>& p) {
+      Codec<A>::write(out, p.first);
+      Codec<B>::write(out, p.second);
+    }
+    static std::pair<A,B> read(ByteReader& in) {
+      A a {Codec<A>::read(in)};
+      return {std::move(a), Codec<B>::read(in)};
+    }
+  };
+
+  template <typename T>
+  struct Codec<std::vector<T>> {
+    static void write(ByteWriter& out, const std::vector<T>& v) {
+      out.varint(v.size());
+      writeRun(out, v.data(), v.size());
+    }
+    static std::vector<T> read(ByteReader& in) {
+      std::vector<T> v {};
+      readRun(in, in.varint(), v);
+      return v;
+    }
+  };
+
+  template <typename T>
+  struct Codec<std::set<T>> {
+    static void write(ByteWriter& out, const std::set<T>& s) {
+      out.varint(s.size());
+      for (const T& t : s) Codec<T>::write(out, t);
+    }
+    static std::set<T> read(ByteReader& in) {
+      std::set<T> s {};
+      for (size_t n = in.varint(); n; n--) s.insert(s.end(), Codec<T>::read(in));
+      return s;
+    }
+  };
+
+  template <typename K, typename V>
+  struct Codec<std::map<K,V>> {
+    static void write(ByteWriter& out, const std::map<K,V>& m) {
+      out.varint(m.size());
+      for (auto& kv : m) {
+        Codec<K>::write(out, kv.first);
+        Codec<V>::write(out, kv.second);
+      }
+    }
+    static std::map<K,V> read(ByteReader& in) {
+      std::map<K,V> m {};
+      for (size_t n = in.varint(); n; n--) {
+        K k {Codec<K>::read(in)};
+        m.emplace_hint(m.end(), std::move(k), Codec<V>::read(in));
+      }
+      return m;
+    }
+  };
+
+  template <typename S, typename H>
+  struct Codec<HyperLogLog<S,H>> {
+    static void write(ByteWriter& out, const HyperLogLog<S,H>& h) {
+      out.varint(h.precision);
+      Codec<std::vector<uint8_t>>::write(out, h.registers);
+    }
+    static HyperLogLog<S,H> read(ByteReader& in) {
+      HyperLogLog<S,H> h {static_cast<int>(in.varint())};
+      std::vector<uint8_t> registers {Codec<std::vector<uint8_t>>::read(in)};
+      if (registers.size() != h.registers.size()) throw std::runtime_error {"pipes: corrupt HyperLogLog"};
+      h.registers = std::move(registers);
+      return h;
+    }
+  };
+
+  template <typename S, typename C>
+  struct Codec<QuantileSketch<S,C>> {
+    static void write(ByteWriter& out, const QuantileSketch<S,C>& q) {
+      out.varint(q.k);
+      out.varint(q.n);
+      out.varint(q.odd);
+      Codec<std::vector<std::vector<S>>>::write(out, q.levels);
+    }
+    static QuantileSketch<S,C> read(ByteReader& in) {
+      QuantileSketch<S,C> q {in.varint()};
+      q.n = in.varint();
+      q.odd = in.varint();
+      q.levels = Codec<std::vector<std::vector<S>>>::read(in);
+      if (q.levels.empty()) q.levels.emplace_back();
+      return q;
+    }
+  };
+
+  template <typename S, typename H>
+  struct Codec<HeavyHitters<S,H>> {
+    static void write(ByteWriter& out, const HeavyHitters<S,H>& h) {
+      out.varint(h.capacity);
+      out.varint(h.offset);
+      out.varint(h.counters.size());
+      for (auto& c : h.counters) {
+        Codec<S>::write(out, c.first);
+        out.varint(c.second);
+      }
+    }
+    static HeavyHitters<S,H> read(ByteReader& in) {
+      HeavyHitters<S,H> h {in.varint()};
+      h.offset = in.varint();
+      for (size_t n = in.varint(); n; n--) {
+        S s {Codec<S>::read(in)};
+        h.counters[std::move(s)] = in.varint();
+      }
+      return h;
+    }
+  };
+
+  template <typename T>
+  std::vector<char> encode(const T& t) {
+    ByteWriter out {};
+    Codec<T>::write(out, t);
+    return std::move(out.bytes);
+  }
+
+  template <typename T>
+  T decode(const std::vector<char>& bytes) {
+    ByteReader in {bytes.data(), bytes.size()};
+    return Codec<T>::read(in);
+  }
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef PIPES_INDEX_H
+#define PIPES_INDEX_H
+
+#include "pipes.h"
+
+#include <string_view>
+
+namespace pipes {
+  template <typename S>
+  struct Slice {
+    const S* first {};
+    const S* last {};
+    const S* begin() const { return first; }
+    const S* end() const { return last; }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+  };
+
+  inline void prefetch(const void* address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#endif
+  }
+
+  template <typename H, typename = void>
+  struct IsTransparent : std::false_type {};
+  template <typename H>
+  struct IsTransparent<H, std::void_t<typename H::is_transparent>> : std::true_type {};
+
+  // Both indexes store each key once and the elements of a key next to
+  // each other in one array, in input order, so a lookup touches a few
+  // cache lines instead of walking map nodes. Keys of another type are
+  // accepted when they compare with K (e.g. string_view for string).
+  template <typename K, typename S, typename H = std::hash<K>>
+  class HashIndex {
+    std::vector<K> keys {};
+    std::vector<size_t> offsets {};
+    std::vector<S> values {};
+    FlatIndexSet table;
+    // Every key goes through H: as-is when H is transparent, as a
+    // string_view for the default string hash (the two agree), and
+    // otherwise converted to K first.
+    template <typename Q>
+    static uint64_t hashOf(const Q& q) {
+      if constexpr (std::is_same_v<Q,K> || IsTransparent<H>::value) {
+        return mixHash(H {}(q));
+      } else if constexpr (std::is_same_v<H,std::hash<std::string>> && std::is_convertible_v<const Q&, std::string_view>) {
+        return mixHash(std::hash<std::string_view> {}(std::string_view {q}));
+      } else {
+        return mixHash(H {}(K(q)));
+      }
+    }
+    template <typename Q>
+    Slice<S> lookup(uint64_t hash, const Q& key) const {
+      std::optional<size_t> k {table.find(hash, [&](size_t j){ return keys[j] == key; })};
+      if (!k) return {};
+      return {values.data() + offsets[*k], values.data() + offsets[*k + 1]};
+    }
+  public:
+    template <typename R, typename F>
+    HashIndex(const R& items, F key) : table {size_t(std::distance(std::begin(items), std::end(items)))} {
+      std::vector<size_t> ids {};
+      std::vector<size_t> counts {};
+      for (const S& s : items) {
+        K k {key(s)};
+        size_t id {table.findOrInsert(hashOf(k), keys.size(), [&](size_t j){ return keys[j] == k; })};
+        if (id == keys.size()) {
+          keys.push_back(std::move(k));
+          counts.push_back(0);
+        }
+        ids.push_back(id);
+        counts[id]++;
+      }
+      offsets.assign(keys.size() + 1, 0);
+      for (size_t k {}; k!=keys.size(); k++) offsets[k + 1] = offsets[k] + counts[k];
+      std::vector<size_t> order(ids.size());
+      std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+      for (size_t i {}; i!=ids.size(); i++) order[next[ids[i]]++] = i;
+      auto first = std::begin(items);
+      values.reserve(order.size());
+      for (size_t i : order) values.push_back(first[i]);
+    }
+    template <typename Q>
+    Slice<S> find(const Q& key) const { return lookup(hashOf(key), key); }
+    template <typename Q>
+    bool contains(const Q& key) const { return !find(key).empty(); }
+    size_t size() const { return keys.size(); }
+    // Hashes a batch of keys and prefetches their slots before probing any
+    // of them, so the cache misses of one batch overlap.
+    template <typename I, typename F>
+    void findAll(I begin, I end, F found) const {
+      constexpr size_t batch {16};
+      uint64_t hashes[batch];
+      while (begin != end) {
+        I first {begin};
+        size_t n {};
+        for (; n!=batch && begin != end; n++, ++begin) {
+          hashes[n] = hashOf(*begin);
+          prefetch(table.probe(hashes[n]));
+        }
+        for (size_t i {}; i!=n; i++, ++first) found(*first, lookup(hashes[i], *first));
+      }
+    }
+  };
+
+  // Keys are kept in Eytzinger (breadth-first) order, so a search walks
+  // down one array and the next levels can be prefetched; it also answers
+  // range queries since equal and adjacent keys are stored in key order.
+  template <typename K, typename S>
+  class SortedIndex {
+    std::vector<K> tree {};
+    std::vector<size_t> rank {};
+    std::vector<size_t> offsets {};
+    std::vector<S> values {};
+    size_t fill(size_t i, size_t k) {
+      if (k > rank.size()) return i;
+      i = fill(i, 2 * k);
+      rank[k - 1] = i;
+      return fill(i + 1, 2 * k + 1);
+    }
+    // Walking right at every level leaves trailing one bits on the final
+    // position; dropping them and one more bit gives the answer.
+    static size_t answer(size_t k) {
+      while (k & 1) k >>= 1;
+      return k >> 1;
+    }
+    template <typename Q>
+    Slice<S> matchAt(size_t k, const Q& key) const {
+      if (!k || key < tree[k - 1]) return {};
+      return {values.data() + offsets[rank[k - 1]], values.data() + offsets[rank[k - 1] + 1]};
+    }
+    // The tree position of the first key not less than q (or greater
+    // than q when upper is set), or 0 when there is none.
+    template <typename Q>
+    size_t descend(const Q& q, bool upper) const {
+      size_t n {rank.size()};
+      size_t k {1};
+      while (k <= n) {
+        if (16 * k <= n) prefetch(&tree[16 * k - 1]);
+        k = 2 * k + (upper ? !(q < tree[k - 1]) : tree[k - 1] < q);
+      }
+      return answer(k);
+    }
+    size_t position(size_t k) const { return k ? rank[k - 1] : rank.size(); }
+  public:
+    template <typename R, typename F>
+    SortedIndex(const R& items, F key) {
+      std::vector<K> itemKeys {};
+      for (const S& s : items) itemKeys.push_back(key(s));
+      std::vector<size_t> order(itemKeys.size());
+      for (size_t i {}; i!=order.size(); i++) order[i] = i;
+      std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return itemKeys[a] < itemKeys[b]; });
+      std::vector<K> sorted {};
+      auto first = std::begin(items);
+      values.reserve(order.size());
+      for (size_t i : order) {
+        if (sorted.empty() || sorted.back() < itemKeys[i]) {
+          sorted.push_back(itemKeys[i]);
+          offsets.push_back(values.size());
+        }
+        values.push_back(first[i]);
+      }
+      offsets.push_back(values.size());
+      rank.resize(sorted.size());
+      fill(0, 1);
+      tree.reserve(sorted.size());
+      for (size_t i : rank) tree.push_back(std::move(sorted[i]));
+    }
+    template <typename Q>
+    Slice<S> find(const Q& key) const { return matchAt(descend(key, false), key); }
+    template <typename Q>
+    bool contains(const Q& key) const { return !find(key).empty(); }
+    // Every element whose key lies in [low, high].
+    template <typename Q>
+    Slice<S> between(const Q& low, const Q& high) const {
+      size_t a {position(descend(low, false))};
+      size_t b {std::max(a, position(descend(high, true)))};
+      return {values.data() + offsets[a], values.data() + offsets[b]};
+    }
+    size_t size() const { return rank.size(); }
+    // Walks a batch of searches down the tree level by level, prefetching
+    // each search's next node while the others take their step.
+    template <typename I, typename F>
+    void findAll(I begin, I end, F found) const {
+      constexpr size_t batch {8};
+      size_t n {rank.size()};
+      size_t k[batch];
+      while (begin != end) {
+        I first {begin};
+        size_t m {};
+        for (; m!=batch && begin != end; m++, ++begin) k[m] = 1;
+        for (bool active {n > 0}; active;) {
+          active = false;
+          I q {first};
+          for (size_t i {}; i!=m; i++, ++q) {
+            if (k[i] > n) continue;
+            k[i] = 2 * k[i] + (tree[k[i] - 1] < *q);
+            if (k[i] <= n) {
+              prefetch(&tree[k[i] - 1]);
+              active = true;
+            }
+          }
+        }
+        for (size_t i {}; i!=m; i++, ++first) found(*first, matchAt(answer(k[i]), *first));
+      }
+    }
+  };
+
+  template <typename K, typename S, typename F>
+  HashIndex<K,S> indexBy(const Pipe<S>& pipe, F key) {
+    return {pipe, key};
+  }
+
+  template <typename K, typename S, typename F>
+  SortedIndex<K,S> sortedIndexBy(const Pipe<S>& pipe, F key) {
+    return {pipe, key};
+  }
+}
+
+#endif
@@ -6,12 +6,28 @@
 #include <vector>
 #include <array>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <map>
 #include <set>
+#include <deque>
+#include <list>
 #include <array>
 #include <algorithm>
 #include <optional>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <type_traits>
+#include <cmath>
+#include <iterator>
+#include <chrono>
+#include <fstream>
+#include <cstdlib>
+#include <cstdint>
+#include <stdexcept>
+
+#include "sketches.h"
 
 namespace pipes {
   template <typename T>
@@ -19,168 +35,1137 @@ namespace pipes {
   template <typename T, size_t N>
   using ArrayPtr = std::shared_ptr<std::array<T,N>>;
 
+  template <typename T>
+  struct Stats {
+    size_t count {};
+    double sum {};
+    double mean {};
+    double m2 {};
+    std::optional<T> min {};
+    std::optional<T> max {};
+    size_t argMin {};
+    size_t argMax {};
+    void add(const T& t, size_t index) {
+      double x = static_cast<double>(t);
+      count++;
+      sum += x;
+      double delta {x - mean};
+      mean += delta / count;
+      m2 += delta * (x - mean);
+      if (!min || t < *min) { min = t; argMin = index; }
+      if (!max || *max < t) { max = t; argMax = index; }
+    }
+    // Other holds the elements that follow these, numbered from 0 as
+    // stats() numbers them, so its positions are shifted past ours.
+    Stats<T>& merge(const Stats<T>& other) {
+      if (!other.count) return *this;
+      if (!count) return *this = other;
+      if (*other.min < *min) {
+        min = other.min;
+        argMin = count + other.argMin;
+      }
+      if (*max < *other.max) {
+        max = other.max;
+        argMax = count + other.argMax;
+      }
+      double n = count + other.count;
+      double delta {other.mean - mean};
+      mean += delta * other.count / n;
+      m2 += other.m2 + delta * delta * count * other.count / n;
+      sum += other.sum;
+      count += other.count;
+      return *this;
+    }
+    double variance() const { return count ? m2 / count : 0.0; }
+    double sampleVariance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+  };
+
+  struct Parallelism {
+    size_t chunkSize {1 << 16};
+    unsigned threads {};
+    unsigned resolvedThreads() const {
+      return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    }
+  };
+
+  template <typename F>
+  void runParallel(size_t tasks, unsigned threads, F task) {
+    threads = std::min<size_t>(tasks, threads);
+    if (threads <= 1) {
+      for (size_t i {}; i!=tasks; i++) task(i);
+      return;
+    }
+    std::atomic<size_t> next {};
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers {};
+    for (unsigned t {}; t!=threads; t++) {
+      workers.emplace_back([&, t]() {
+        try {
+          for (size_t i {next++}; i < tasks; i = next++) task(i);
+        } catch (...) {
+          errors[t] = std::current_exception();
+        }
+      });
+    }
+    for (std::thread& worker : workers) worker.join();
+    for (std::exception_ptr& error : errors) {
+      if (error) std::rethrow_exception(error);
+    }
+  }
+
+  enum class Strategy { Sequential, Vectorized, Parallel, Adaptive };
+
+  // Measured cost of starting and joining a worker thread. It is taken
+  // once per process, or read from the file named by PIPES_CALIBRATION
+  // (and written there the first time) so later runs skip the measurement.
+  struct Calibration {
+    double threadNanos {};
+    static Calibration measure() {
+      std::vector<double> samples {};
+      for (int i {}; i!=9; i++) {
+        auto start = std::chrono::steady_clock::now();
+        std::thread {[]{}}.join();
+        samples.push_back(std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now() - start).count());
+      }
+      std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+      return {samples[samples.size() / 2]};
+    }
+    bool load(const std::string& path) {
+      std::ifstream in {path};
+      std::string key {};
+      double value {};
+      if (!(in >> key >> value) || key != "threadNanos" || value <= 0) return false;
+      threadNanos = value;
+      return true;
+    }
+    bool save(const std::string& path) const {
+      std::ofstream out {path};
+      out << "threadNanos " << threadNanos << "\n";
+      return bool(out);
+    }
+    static const Calibration& get() {
+      static const Calibration calibration {[]{
+        Calibration c {};
+        const char* path {std::getenv("PIPES_CALIBRATION")};
+        if (path && c.load(path)) return c;
+        c = measure();
+        if (path) c.save(path);
+        return c;
+      }()};
+      return calibration;
+    }
+  };
+
+  inline Strategy chooseStrategy(size_t remaining, double nanosPerElement, bool vectorizable, unsigned threads) {
+    double sequential {remaining * nanosPerElement};
+    double parallel {sequential / threads + Calibration::get().threadNanos * threads};
+    if (threads > 1 && parallel < 0.75 * sequential) return Strategy::Parallel;
+    return vectorizable ? Strategy::Vectorized : Strategy::Sequential;
+  }
+
+  enum class Status { Completed, Cancelled, DeadlineExceeded };
+
+  class CancellationToken {
+    std::shared_ptr<std::atomic<bool>> flag {std::make_shared<std::atomic<bool>>(false)};
+  public:
+    void cancel() const { *flag = true; }
+    bool cancelled() const { return *flag; }
+  };
+
+  class MemoryBudgetExceeded : public std::runtime_error {
+  public:
+    size_t requested;
+    size_t inUse;
+    size_t budget;
+    MemoryBudgetExceeded(size_t requested, size_t inUse, size_t budget)
+      : std::runtime_error {"pipes: memory budget exceeded: " + std::to_string(requested) + " more bytes requested with "
+          + std::to_string(inUse) + " of " + std::to_string(budget) + " in use"},
+        requested {requested}, inUse {inUse}, budget {budget} {}
+  };
+
+  // Counts the bytes held by the buffers of derived pipes that share it.
+  // A buffer is charged when its stage completes and released when the
+  // last pipe holding it goes away.
+  class MemoryTracker {
+    std::atomic<size_t> used {};
+    std::atomic<size_t> peakUsed {};
+    size_t budget;
+  public:
+    explicit MemoryTracker(size_t budget = SIZE_MAX) : budget {budget} {}
+    void acquire(size_t bytes) {
+      size_t now {used};
+      do {
+        if (bytes > budget - std::min(now, budget)) throw MemoryBudgetExceeded {bytes, now, budget};
+      } while (!used.compare_exchange_weak(now, now + bytes));
+      for (size_t seen {peakUsed}; now + bytes > seen && !peakUsed.compare_exchange_weak(seen, now + bytes);) {}
+    }
+    void release(size_t bytes) { used -= bytes; }
+    size_t current() const { return used; }
+    size_t peak() const { return peakUsed; }
+    size_t limit() const { return budget; }
+  };
+
+  // Bytes held against a tracker on behalf of one buffer. A stage charges
+  // its expected size before allocating, so going over the budget throws
+  // before the memory is taken, and settles on the real size afterwards.
+  class MemoryCharge {
+    std::shared_ptr<MemoryTracker> memory;
+    size_t bytes {};
+  public:
+    MemoryCharge(std::shared_ptr<MemoryTracker> memory = {}, size_t bytes = 0) : memory {std::move(memory)} { set(bytes); }
+    MemoryCharge(const MemoryCharge& other) : MemoryCharge {other.memory, other.bytes} {}
+    MemoryCharge(MemoryCharge&& other) : memory {std::move(other.memory)}, bytes {std::exchange(other.bytes, 0)} {}
+    MemoryCharge& operator=(MemoryCharge other) {
+      std::swap(memory, other.memory);
+      std::swap(bytes, other.bytes);
+      return *this;
+    }
+    ~MemoryCharge() {
+      if (memory) memory->release(bytes);
+    }
+    void set(size_t wanted) {
+      if (!memory) return;
+      if (wanted > bytes) {
+        memory->acquire(wanted - bytes);
+      } else {
+        memory->release(bytes - wanted);
+      }
+      bytes = wanted;
+    }
+    size_t size() const { return bytes; }
+  };
+
+  struct Context {
+    Strategy strategy {Strategy::Sequential};
+    Parallelism parallelism {};
+    size_t sampleSize {256};
+    std::optional<CancellationToken> cancellation {};
+    std::optional<std::chrono::steady_clock::time_point> deadline {};
+    size_t checkInterval {4096};
+    std::shared_ptr<MemoryTracker> memory {};
+    bool interruptible() const { return cancellation || deadline; }
+    Status interruption() const {
+      if (cancellation && cancellation->cancelled()) return Status::Cancelled;
+      if (deadline && std::chrono::steady_clock::now() >= *deadline) return Status::DeadlineExceeded;
+      return Status::Completed;
+    }
+  };
+
+  template <typename T>
+  VectorPtr<T> tracked(std::vector<T>&& items, const Context& context, MemoryCharge&& charged = {}) {
+    if (!context.memory) return std::make_shared<std::vector<T>>(std::move(items));
+    if (!charged.size()) charged = MemoryCharge {context.memory};
+    charged.set(items.capacity() * sizeof(T));
+    return VectorPtr<T> {new std::vector<T>(std::move(items)), [charged = std::move(charged)](std::vector<T>* v){
+      delete v;
+    }};
+  }
+
+  template <typename T>
+  struct CompensatedSum {
+    T sum {};
+    T compensation {};
+    void add(T x) {
+      T t {sum + x};
+      if (std::abs(sum) >= std::abs(x)) {
+        compensation += (sum - t) + x;
+      } else {
+        compensation += (x - t) + sum;
+      }
+      sum = t;
+    }
+    CompensatedSum<T>& merge(const CompensatedSum<T>& other) {
+      add(other.sum);
+      compensation += other.compensation;
+      return *this;
+    }
+    T value() const { return sum + compensation; }
+  };
+
+  enum class Order { None, Ascending, Descending };
+
+  struct Properties {
+    Order order {Order::None};
+    bool unique {};
+    Properties reversed() const {
+      Order flipped {order == Order::Ascending ? Order::Descending : order == Order::Descending ? Order::Ascending : Order::None};
+      return {flipped, unique};
+    }
+  };
+
+  template <typename D>
+  struct Emitter {
+    std::vector<D>& out;
+    void operator()(const D& d) const { out.push_back(d); }
+    void operator()(D&& d) const { out.push_back(std::move(d)); }
+  };
+
+  template <typename C, typename = void>
+  struct IsIterable : std::false_type {};
+  template <typename C>
+  struct IsIterable<C, std::void_t<decltype(std::begin(std::declval<C&>()) != std::end(std::declval<C&>()))>> : std::true_type {};
+  template <typename C, typename = void>
+  struct HasSize : std::false_type {};
+  template <typename C>
+  struct HasSize<C, std::void_t<decltype(std::size(std::declval<const C&>()))>> : std::true_type {};
+  template <typename C, typename = void>
+  struct HasReserve : std::false_type {};
+  template <typename C>
+  struct HasReserve<C, std::void_t<decltype(std::declval<C&>().reserve(size_t {}))>> : std::true_type {};
+  template <typename C, typename = void>
+  struct HasPushBack : std::false_type {};
+  template <typename C>
+  struct HasPushBack<C, std::void_t<decltype(std::declval<C&>().push_back(std::declval<typename C::value_type>()))>> : std::true_type {};
+
+  // Containers known to own their elements; any other range may be a view
+  // onto storage that outlives it.
+  template <typename C>
+  struct IsOwning : std::false_type {};
+  template <typename T, typename A>
+  struct IsOwning<std::vector<T,A>> : std::true_type {};
+  template <typename T, size_t N>
+  struct IsOwning<std::array<T,N>> : std::true_type {};
+  template <typename T, typename A>
+  struct IsOwning<std::deque<T,A>> : std::true_type {};
+  template <typename T, typename A>
+  struct IsOwning<std::list<T,A>> : std::true_type {};
+  template <typename T, typename C, typename A>
+  struct IsOwning<std::set<T,C,A>> : std::true_type {};
+  template <typename T, typename C, typename A>
+  struct IsOwning<std::multiset<T,C,A>> : std::true_type {};
+  template <typename T, typename Tr, typename A>
+  struct IsOwning<std::basic_string<T,Tr,A>> : std::true_type {};
+
+  template <typename C>
+  struct IsText : std::false_type {};
+  template <typename T, typename Tr, typename A>
+  struct IsText<std::basic_string<T,Tr,A>> : std::true_type {};
+  template <typename T, typename Tr>
+  struct IsText<std::basic_string_view<T,Tr>> : std::true_type {};
+
+  // Ordered containers iterate in key order, so a pipe built from one
+  // starts out sorted, as long as its elements are taken as they are.
+  // Multimaps are left out: entries with equal keys keep insertion order.
+  template <typename C>
+  struct SourceProperties {
+    using Element = void;
+    static Properties of() { return {}; }
+  };
+  template <typename K, typename V>
+  struct SourceProperties<std::map<K,V>> {
+    using Element = std::pair<K,V>;
+    static Properties of() { return {Order::Ascending, true}; }
+  };
+  template <typename T>
+  struct SourceProperties<std::set<T>> {
+    using Element = T;
+    static Properties of() { return {Order::Ascending, true}; }
+  };
+  template <typename T>
+  struct SourceProperties<std::multiset<T>> {
+    using Element = T;
+    static Properties of() { return {Order::Ascending, false}; }
+  };
+
+  // Open addressing over positions in caller-owned storage: a slot holds
+  // position + 1, so the whole table is one flat array. It is sized up
+  // front for `expected` inserts and never rehashes.
+  class FlatIndexSet {
+    std::vector<size_t> slots;
+    size_t mask;
+    static size_t capacityFor(size_t expected) {
+      size_t capacity {16};
+      while (capacity < expected * 2) capacity <<= 1;
+      return capacity;
+    }
+  public:
+    explicit FlatIndexSet(size_t expected) : slots(capacityFor(expected)), mask {slots.size() - 1} {}
+    static size_t bytesFor(size_t expected) { return capacityFor(expected) * sizeof(size_t); }
+    // Returns the stored position matching, or stores and returns `position`.
+    template <typename M>
+    size_t findOrInsert(uint64_t hash, size_t position, M matches) {
+      for (size_t i {hash & mask};; i = (i + 1) & mask) {
+        if (!slots[i]) {
+          slots[i] = position + 1;
+          return position;
+        }
+        if (matches(slots[i] - 1)) return slots[i] - 1;
+      }
+    }
+    template <typename M>
+    bool insert(uint64_t hash, size_t position, M matches) {
+      return findOrInsert(hash, position, matches) == position;
+    }
+    template <typename M>
+    std::optional<size_t> find(uint64_t hash, M matches) const {
+      for (size_t i {hash & mask};; i = (i + 1) & mask) {
+        if (!slots[i]) return std::nullopt;
+        if (matches(slots[i] - 1)) return slots[i] - 1;
+      }
+    }
+    template <typename M>
+    bool contains(uint64_t hash, M matches) const {
+      return find(hash, matches).has_value();
+    }
+    const size_t* probe(uint64_t hash) const { return &slots[hash & mask]; }
+  };
+
+  template <typename S>
+  class Selection;
+
   template <typename S>
   class Pipe {
+    template <typename> friend class Pipe;
   protected:
     VectorPtr<S> source;
+    Properties properties {};
+    Context context {};
+    Status status {Status::Completed};
+    bool ownsSource() const { return source.use_count() == 1 && !context.interruptible(); }
+    template <typename D>
+    Pipe<D> derive(std::vector<D>&& result, Properties p = {}, MemoryCharge&& charged = {}) const {
+      Pipe<D> derived {tracked(std::move(result), context, std::move(charged)), p, context};
+      derived.status = status;
+      return derived;
+    }
+    template <typename D>
+    MemoryCharge charge(size_t n) const { return {context.memory, n * sizeof(D)}; }
+    Pipe<S> reuse(Properties p) {
+      Pipe<S> reused {std::move(source), p, context};
+      reused.status = status;
+      return reused;
+    }
+    bool interrupted() {
+      Status reason {context.interruption()};
+      if (reason == Status::Completed) return false;
+      status = reason;
+      return true;
+    }
+    template <typename K>
+    void chunked(size_t n, K kernel) {
+      if (!context.interruptible()) {
+        kernel(0, n);
+        return;
+      }
+      size_t step {std::max<size_t>(1, context.checkInterval)};
+      for (size_t begin {}; begin < n; begin += step) {
+        if (interrupted() || !kernel(begin, std::min(n, begin + step))) return;
+      }
+    }
+    template <typename K>
+    size_t forRanges(size_t begin, size_t end, K kernel) {
+      size_t chunkSize {std::max<size_t>(1, context.parallelism.chunkSize)};
+      size_t chunks {(end - begin + chunkSize - 1) / chunkSize};
+      std::atomic<size_t> stopped {chunks};
+      runParallel(chunks, context.parallelism.resolvedThreads(), [&](size_t c){
+        if (context.interruptible() && context.interruption() != Status::Completed) {
+          for (size_t seen {stopped}; c < seen && !stopped.compare_exchange_weak(seen, c);) {}
+          return;
+        }
+        kernel(begin + c * chunkSize, std::min(end, begin + (c + 1) * chunkSize));
+      });
+      if (stopped == chunks) return end;
+      interrupted();
+      return begin + stopped * chunkSize;
+    }
+    template <typename K>
+    Strategy sample(size_t& done, bool vectorizable, K kernel) const {
+      if (context.strategy != Strategy::Adaptive) return context.strategy;
+      done = std::min(source->size(), std::max<size_t>(1, context.sampleSize));
+      auto start = std::chrono::steady_clock::now();
+      kernel(0, done);
+      double nanos {std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now() - start).count()};
+      return chooseStrategy(source->size() - done, nanos / std::max<size_t>(1, done), vectorizable, context.parallelism.resolvedThreads());
+    }
+    template <typename D, typename F>
+    void mapWith(F& mapper, std::vector<D>& result) {
+      size_t n {source->size()};
+      if (static_cast<void*>(&result) != static_cast<void*>(source.get())) result.resize(n);
+      auto kernel = [&](size_t begin, size_t end) {
+        for (size_t i {begin}; i!=end; i++) result[i] = mapper((*source)[i]);
+      };
+      size_t done {};
+      Strategy strategy {sample(done, std::is_arithmetic_v<S> && std::is_arithmetic_v<D>, kernel)};
+      if (strategy == Strategy::Parallel) {
+        result.resize(forRanges(done, n, kernel));
+      } else {
+        size_t reached {done};
+        chunked(n - done, [&](size_t begin, size_t end){
+          kernel(done + begin, done + end);
+          reached = done + end;
+          return true;
+        });
+        result.resize(reached);
+      }
+    }
+    template <typename F>
+    void filterRange(F& filter, size_t begin, size_t end, std::vector<S>& out) const {
+      if constexpr (std::is_arithmetic_v<S>) {
+        size_t k {out.size()};
+        out.resize(k + end - begin);
+        for (size_t i {begin}; i!=end; i++) {
+          out[k] = (*source)[i];
+          k += bool(filter((*source)[i]));
+        }
+        out.resize(k);
+      } else {
+        std::copy_if(source->begin() + begin, source->begin() + end, std::back_inserter(out), filter);
+      }
+    }
+    template <typename F>
+    void filterWith(F& filter, std::vector<S>& result) {
+      size_t n {source->size()};
+      size_t done {};
+      Strategy strategy {sample(done, std::is_arithmetic_v<S>, [&](size_t begin, size_t end){
+        filterRange(filter, begin, end, result);
+      })};
+      if (strategy != Strategy::Parallel) {
+        chunked(n - done, [&](size_t begin, size_t end){
+          filterRange(filter, done + begin, done + end, result);
+          return true;
+        });
+        return;
+      }
+      size_t chunkSize {std::max<size_t>(1, context.parallelism.chunkSize)};
+      std::vector<std::vector<S>> parts((n - done + chunkSize - 1) / chunkSize);
+      size_t reached {forRanges(done, n, [&](size_t begin, size_t end){
+        filterRange(filter, begin, end, parts[(begin - done) / chunkSize]);
+      })};
+      parts.resize((reached - done + chunkSize - 1) / chunkSize);
+      size_t total {result.size()};
+      for (auto& part : parts) total += part.size();
+      result.reserve(total);
+      for (auto& part : parts) {
+        result.insert(result.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+      }
+    }
+    template <typename P>
+    size_t findIndex(P predicate) {
+      size_t found {source->size()};
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) {
+          if (predicate((*source)[i])) {
+            found = i;
+            return false;
+          }
+        }
+        return true;
+      });
+      return found;
+    }
+    // Only as long as the prefix that was tested before an interruption.
+    template <typename P>
+    std::vector<bool> mask(P& predicate, size_t& selected) {
+      std::vector<bool> result(source->size());
+      size_t reached {};
+      selected = 0;
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) {
+          bool keep = predicate((*source)[i]);
+          result[i] = keep;
+          selected += keep;
+        }
+        reached = end;
+        return true;
+      });
+      result.resize(reached);
+      return result;
+    }
+    template <typename H>
+    static uint64_t hashOf(const S& s) { return mixHash(H {}(s)); }
+    bool sortedLike(const Pipe<S>& other) const {
+      return properties.order != Order::None && properties.order == other.properties.order;
+    }
+    bool before(const S& a, const S& b) const {
+      return properties.order == Order::Descending ? b < a : a < b;
+    }
+    Pipe<S> merged(const Pipe<S>& other, bool left, bool both, bool right) {
+      const std::vector<S>& a {*source};
+      const std::vector<S>& b {*other.source};
+      MemoryCharge charged {charge<S>(right ? a.size() + b.size() : a.size())};
+      std::vector<S> result {};
+      result.reserve(right ? a.size() + b.size() : a.size());
+      auto emit = [&](const S& s){
+        if (result.empty() || before(result.back(), s)) result.push_back(s);
+      };
+      size_t i {};
+      size_t j {};
+      while (i < a.size() && j < b.size()) {
+        if (before(a[i], b[j])) {
+          if (left) emit(a[i]);
+          i++;
+        } else if (before(b[j], a[i])) {
+          if (right) emit(b[j]);
+          j++;
+        } else {
+          const S& value {a[i]};
+          if (both) emit(value);
+          while (i < a.size() && !before(value, a[i])) i++;
+          while (j < b.size() && !before(value, b[j])) j++;
+        }
+      }
+      if (left) for (; i < a.size(); i++) emit(a[i]);
+      if (right) for (; j < b.size(); j++) emit(b[j]);
+      return derive(std::move(result), Properties {properties.order, true}, std::move(charged));
+    }
+    template <typename H, typename P>
+    Pipe<S> matching(const Pipe<S>& other, P keep) {
+      const std::vector<S>& b {*other.source};
+      MemoryCharge tables {context.memory, FlatIndexSet::bytesFor(b.size()) + FlatIndexSet::bytesFor(source->size())};
+      MemoryCharge charged {charge<S>(source->size())};
+      FlatIndexSet right {b.size()};
+      for (size_t j {}; j!=b.size(); j++) {
+        right.insert(hashOf<H>(b[j]), j, [&](size_t k){ return b[k] == b[j]; });
+      }
+      std::vector<S> result {};
+      FlatIndexSet seen {source->size()};
+      for (const S& s : *source) {
+        uint64_t h {hashOf<H>(s)};
+        if (keep(right.contains(h, [&](size_t k){ return b[k] == s; }))
+            && seen.insert(h, result.size(), [&](size_t k){ return result[k] == s; })) {
+          result.push_back(s);
+        }
+      }
+      return derive(std::move(result), Properties {properties.order, true}, std::move(charged));
+    }
+    template <typename C, typename I>
+    void append(C& c, I begin, I end) const {
+      if constexpr (HasReserve<C>::value) c.reserve(c.size() + source->size());
+      if constexpr (HasPushBack<C>::value) {
+        c.insert(c.end(), begin, end);
+      } else {
+        c.insert(begin, end);
+      }
+    }
+    template <typename C>
+    Properties sortedProperties() const {
+      if constexpr (std::is_same_v<C,std::less<S>>) return {Order::Ascending, properties.unique};
+      return {Order::None, properties.unique};
+    }
   public:
     Pipe(std::vector<S>& s) : source {std::make_shared<std::vector<S>>(s)} {}
-    Pipe(std::vector<S>&& s) : source {std::make_shared<std::vector<S>>(s)} {}
-    Pipe(std::set<S>& s) : Pipe {std::vector<S>(s.begin(), s.end())} {}
-    Pipe(std::set<S>&& s) : Pipe {std::vector<S>(s.begin(), s.end())} {}
+    Pipe(std::vector<S>&& s) : source {std::make_shared<std::vector<S>>(std::move(s))} {}
+    Pipe(std::set<S>& s) : Pipe {std::vector<S>(s.begin(), s.end()), Properties {Order::Ascending, true}} {}
+    Pipe(std::set<S>&& s) : Pipe {std::vector<S>(s.begin(), s.end()), Properties {Order::Ascending, true}} {}
     template <size_t N>
     Pipe(std::array<S,N>& s) : Pipe {std::vector<S>(s.begin(), s.end())} {}
     template <size_t N>
     Pipe(std::array<S,N>&& s) : Pipe {std::vector<S>(s.begin(), s.end())} {}
-    Pipe(VectorPtr<S> s) : source {s} {}
+    Pipe(std::vector<S>&& s, Properties p) : source {std::make_shared<std::vector<S>>(std::move(s))}, properties {p} {}
+    Pipe(VectorPtr<S> s, Properties p = {}, Context c = {}) : source {std::move(s)}, properties {p}, context {c} {}
+    // Any range whose elements convert implicitly to S, including a const
+    // vector<S>, which is copied whole. Text only feeds pipes of its own
+    // characters.
+    template <typename C, typename Plain = std::remove_cv_t<std::remove_reference_t<C>>, typename = std::enable_if_t<
+      IsIterable<Plain>::value && !std::is_base_of_v<Pipe<S>,Plain> && (!IsText<Plain>::value || std::is_same_v<typename Plain::value_type,S>)
+      && std::is_convertible_v<decltype(*std::begin(std::declval<C&>())), S>>>
+    Pipe(C&& c) : source {std::make_shared<std::vector<S>>()} {
+      if constexpr (std::is_same_v<Plain,std::vector<S>>) {
+        *source = c;
+        return;
+      }
+      if constexpr (std::is_same_v<typename SourceProperties<Plain>::Element,S>) properties = SourceProperties<Plain>::of();
+      if constexpr (HasSize<Plain>::value) source->reserve(std::size(c));
+      for (auto&& item : c) {
+        if constexpr (std::is_lvalue_reference_v<C>) {
+          source->push_back(item);
+        } else {
+          source->push_back(std::move(item));
+        }
+      }
+    }
+    const Properties& getProperties() const { return properties; }
+    const Context& getContext() const { return context; }
+    Status getStatus() const { return status; }
+    Pipe<S> withCancellation(CancellationToken token, size_t checkInterval = 4096) const {
+      Pipe<S> result {*this};
+      result.context.cancellation = token;
+      result.context.checkInterval = checkInterval;
+      return result;
+    }
+    Pipe<S> withDeadline(std::chrono::steady_clock::time_point deadline, size_t checkInterval = 4096) const {
+      Pipe<S> result {*this};
+      result.context.deadline = deadline;
+      result.context.checkInterval = checkInterval;
+      return result;
+    }
+    Pipe<S> withMemoryTracker(std::shared_ptr<MemoryTracker> tracker) const {
+      Pipe<S> result {*this};
+      result.context.memory = std::move(tracker);
+      return result;
+    }
+    Pipe<S> withMemoryBudget(size_t bytes) const {
+      return withMemoryTracker(std::make_shared<MemoryTracker>(bytes));
+    }
+    const std::shared_ptr<MemoryTracker>& getMemoryTracker() const { return context.memory; }
+    template <typename R, typename P>
+    Pipe<S> withTimeout(std::chrono::duration<R,P> timeout, size_t checkInterval = 4096) const {
+      return withDeadline(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout), checkInterval);
+    }
+    Pipe<S> withStrategy(Strategy strategy, Parallelism parallelism = {}) const {
+      Pipe<S> result {*this};
+      result.context.strategy = strategy;
+      result.context.parallelism = parallelism;
+      return result;
+    }
+    typename std::vector<S>::const_iterator begin() const { return source->cbegin(); }
+    typename std::vector<S>::const_iterator end() const { return source->cend(); }
     template <typename F>
     void forEach(F f) {
-      for (S& s : *source) {
-        f(s);
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) f((*source)[i]);
+        return true;
+      });
+    }
+    template <typename D, typename F>
+    Pipe<D> map(F mapper) & {
+      MemoryCharge charged {charge<D>(source->size())};
+      std::vector<D> result {};
+      if constexpr (std::is_default_constructible_v<D> && !std::is_same_v<D,bool>) {
+        if (context.strategy != Strategy::Sequential) {
+          mapWith(mapper, result);
+          return derive(std::move(result), {}, std::move(charged));
+        }
+      }
+      result.reserve(source->size());
+      chunked(source->size(), [&](size_t begin, size_t end){
+        std::transform(source->begin() + begin, source->begin() + end, std::back_inserter(result), mapper);
+        return true;
+      });
+      return derive(std::move(result), {}, std::move(charged));
+    }
+    template <typename D, typename F>
+    Pipe<D> map(F mapper) && {
+      if constexpr (std::is_same_v<D,S>) {
+        if (ownsSource()) {
+          if constexpr (std::is_default_constructible_v<S> && !std::is_same_v<S,bool>) {
+            if (context.strategy != Strategy::Sequential) {
+              mapWith(mapper, *source);
+              return reuse({});
+            }
+          }
+          std::transform(source->begin(), source->end(), source->begin(), mapper);
+          return reuse({});
+        }
       }
+      return map<D>(mapper);
     }
     template <typename D, typename F>
-    Pipe<D> map(F mapper) {
+    Pipe<D> mapIndexed(F mapper) {
+      MemoryCharge charged {charge<D>(source->size())};
       std::vector<D> result {};
       result.reserve(source->size());
-      std::transform(source->begin(), source->end(), std::back_inserter(result), mapper);
-      return Pipe<D> {std::make_shared<std::vector<D>>(result)};
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) result.push_back(mapper(i, (*source)[i]));
+        return true;
+      });
+      return derive(std::move(result), {}, std::move(charged));
+    }
+    template <typename D, typename T, typename F>
+    Pipe<D> zipWith(const Pipe<T>& other, F zipper) {
+      size_t n {std::min(source->size(), other.source->size())};
+      MemoryCharge charged {charge<D>(n)};
+      std::vector<D> result {};
+      result.reserve(n);
+      chunked(n, [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) result.push_back(zipper((*source)[i], (*other.source)[i]));
+        return true;
+      });
+      return derive(std::move(result), {}, std::move(charged));
     }
     template <typename D, typename F>
-    Pipe<D> flatMap(F mapper) {
+    Pipe<D> flatMap(F mapper, size_t expected = 0) {
+      MemoryCharge charged {charge<D>(expected)};
       std::vector<D> result {};
-      for (S& s : *source) {
-        std::vector<D> partial {mapper(s)};
-        std::copy(partial.begin(), partial.end(), std::back_inserter(result));
-      }
-      return Pipe<D> {std::make_shared<std::vector<D>>(result)};
+      result.reserve(expected);
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) {
+          S& s {(*source)[i]};
+          if constexpr (std::is_invocable_v<F&, S&, Emitter<D>>) {
+            mapper(s, Emitter<D> {result});
+          } else if constexpr (std::is_reference_v<decltype(mapper(s))>) {
+            auto& partial = mapper(s);
+            result.insert(result.end(), std::begin(partial), std::end(partial));
+          } else if constexpr (IsOwning<decltype(mapper(s))>::value) {
+            auto partial = mapper(s);
+            result.insert(result.end(), std::make_move_iterator(std::begin(partial)), std::make_move_iterator(std::end(partial)));
+          } else {
+            auto partial = mapper(s);
+            result.insert(result.end(), std::begin(partial), std::end(partial));
+          }
+        }
+        return true;
+      });
+      return derive(std::move(result), {}, std::move(charged));
     }
     template <typename F>
-    Pipe<S> filter(F filter) {
+    Pipe<S> filter(F filter) & {
+      MemoryCharge charged {charge<S>(source->size())};
       std::vector<S> result {};
+      if constexpr (!std::is_same_v<S,bool>) {
+        if (context.strategy != Strategy::Sequential) {
+          filterWith(filter, result);
+          return derive(std::move(result), properties, std::move(charged));
+        }
+      }
       result.reserve(source->size());
-      std::copy_if(source->begin(), source->end(), std::back_inserter(result), filter);
-      return Pipe<S> {std::make_shared<std::vector<S>>(result)};
+      chunked(source->size(), [&](size_t begin, size_t end){
+        std::copy_if(source->begin() + begin, source->begin() + end, std::back_inserter(result), filter);
+        return true;
+      });
+      return derive(std::move(result), properties, std::move(charged));
+    }
+    template <typename F>
+    Pipe<S> filter(F filter) && {
+      if (!ownsSource() || context.strategy != Strategy::Sequential) return this->filter(filter);
+      source->erase(std::remove_if(source->begin(), source->end(), [&filter](const S& s){ return !filter(s); }), source->end());
+      return reuse(properties);
     }
-    Pipe<S> take(int n) {
+    Pipe<S> take(int n) & {
       std::vector<S> result {};
       int toKeep = source->size();
       toKeep = std::max(0, std::min(n, toKeep));
+      MemoryCharge charged {charge<S>(toKeep)};
       result.reserve(toKeep);
       std::copy_n(source->begin(), toKeep, std::back_inserter(result));
-      return Pipe<S> {std::make_shared<std::vector<S>>(result)};
+      return derive(std::move(result), properties, std::move(charged));
+    }
+    Pipe<S> take(int n) && {
+      if (!ownsSource()) return take(n);
+      int toKeep = source->size();
+      toKeep = std::max(0, std::min(n, toKeep));
+      source->erase(source->begin()+toKeep, source->end());
+      return reuse(properties);
     }
     template <typename P>
-    Pipe<S> takeWhile(P predicate) {
+    Pipe<S> takeWhile(P predicate) & {
+      MemoryCharge charged {charge<S>(source->size())};
       std::vector<S> result {};
       result.reserve(source->size());
-      for (S& s : *source) {
-        if (!predicate(s)) break;
-        result.push_back(s);
-      }
-      return Pipe<S> {std::make_shared<std::vector<S>>(result)};
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) {
+          if (!predicate((*source)[i])) return false;
+          result.push_back((*source)[i]);
+        }
+        return true;
+      });
+      return derive(std::move(result), properties, std::move(charged));
+    }
+    template <typename P>
+    Pipe<S> takeWhile(P predicate) && {
+      if (!ownsSource()) return takeWhile(predicate);
+      source->erase(std::find_if_not(source->begin(), source->end(), predicate), source->end());
+      return reuse(properties);
     }
-    Pipe<S> drop(int n) {
+    Pipe<S> drop(int n) & {
       std::vector<S> result {};
       int toKeep = source->size();
       toKeep -= std::max(0, std::min(n, toKeep));
+      MemoryCharge charged {charge<S>(toKeep)};
       result.reserve(toKeep);
       std::copy_n(source->end()-toKeep, toKeep, std::back_inserter(result));
-      return Pipe<S> {std::make_shared<std::vector<S>>(result)};
+      return derive(std::move(result), properties, std::move(charged));
+    }
+    Pipe<S> drop(int n) && {
+      if (!ownsSource()) return drop(n);
+      int toDrop = source->size();
+      toDrop = std::max(0, std::min(n, toDrop));
+      source->erase(source->begin(), source->begin()+toDrop);
+      return reuse(properties);
     }
     template <typename P>
-    Pipe<S> dropWhile(P predicate) {
+    Pipe<S> dropWhile(P predicate) & {
+      MemoryCharge charged {charge<S>(source->size())};
       std::vector<S> result {};
       result.reserve(source->size());
       bool taking {false};
-      for (S& s : *source) {
-        if (!taking && predicate(s)) continue;
-        taking = true;
-        result.push_back(s);
-      }
-      return Pipe<S> {std::make_shared<std::vector<S>>(result)};
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) {
+          if (!taking && predicate((*source)[i])) continue;
+          taking = true;
+          result.push_back((*source)[i]);
+        }
+        return true;
+      });
+      return derive(std::move(result), properties, std::move(charged));
+    }
+    template <typename P>
+    Pipe<S> dropWhile(P predicate) && {
+      if (!ownsSource()) return dropWhile(predicate);
+      source->erase(source->begin(), std::find_if_not(source->begin(), source->end(), predicate));
+      return reuse(properties);
     }
-    Pipe<S> reverse() {
+    Pipe<S> reverse() & {
+      MemoryCharge charged {charge<S>(source->size())};
       std::vector<S> result {};
       result.reserve(source->size());
       std::copy(source->rbegin(), source->rend(), std::back_inserter(result));
-      return Pipe<S> {std::make_shared<std::vector<S>>(result)};
+      return derive(std::move(result), properties.reversed(), std::move(charged));
+    }
+    Pipe<S> reverse() && {
+      if (!ownsSource()) return reverse();
+      std::reverse(source->begin(), source->end());
+      return reuse(properties.reversed());
+    }
+    template <typename H = std::hash<S>>
+    Pipe<S> distinct() {
+      if (properties.unique) return *this;
+      MemoryCharge charged {charge<S>(source->size())};
+      std::vector<S> result {};
+      if (properties.order != Order::None) {
+        forEach([&](const S& s){
+          if (result.empty() || before(result.back(), s)) result.push_back(s);
+        });
+      } else {
+        MemoryCharge table {context.memory, FlatIndexSet::bytesFor(source->size())};
+        FlatIndexSet seen {source->size()};
+        forEach([&](const S& s){
+          if (seen.insert(hashOf<H>(s), result.size(), [&](size_t k){ return result[k] == s; })) result.push_back(s);
+        });
+      }
+      return derive(std::move(result), Properties {properties.order, true}, std::move(charged));
+    }
+    template <typename K, typename F, typename H = std::hash<K>>
+    Pipe<S> distinctBy(F key) {
+      MemoryCharge table {context.memory, FlatIndexSet::bytesFor(source->size()) + source->size() * sizeof(K)};
+      MemoryCharge charged {charge<S>(source->size())};
+      std::vector<S> result {};
+      std::vector<K> keys {};
+      FlatIndexSet seen {source->size()};
+      forEach([&](const S& s){
+        K k {key(s)};
+        if (seen.insert(mixHash(H {}(k)), keys.size(), [&](size_t i){ return keys[i] == k; })) {
+          keys.push_back(std::move(k));
+          result.push_back(s);
+        }
+      });
+      return derive(std::move(result), Properties {properties.order, true}, std::move(charged));
+    }
+    template <typename H = std::hash<S>>
+    Pipe<S> unionWith(const Pipe<S>& other) {
+      if (sortedLike(other)) return merged(other, true, true, true);
+      size_t n {source->size() + other.source->size()};
+      MemoryCharge table {context.memory, FlatIndexSet::bytesFor(n)};
+      MemoryCharge charged {charge<S>(n)};
+      std::vector<S> result {};
+      FlatIndexSet seen {n};
+      auto add = [&](const S& s){
+        if (seen.insert(hashOf<H>(s), result.size(), [&](size_t k){ return result[k] == s; })) result.push_back(s);
+      };
+      for (const S& s : *source) add(s);
+      for (const S& s : *other.source) add(s);
+      return derive(std::move(result), Properties {Order::None, true}, std::move(charged));
+    }
+    template <typename H = std::hash<S>>
+    Pipe<S> intersect(const Pipe<S>& other) {
+      if (sortedLike(other)) return merged(other, false, true, false);
+      return matching<H>(other, [](bool found){ return found; });
+    }
+    template <typename H = std::hash<S>>
+    Pipe<S> except(const Pipe<S>& other) {
+      if (sortedLike(other)) return merged(other, true, false, false);
+      return matching<H>(other, [](bool found){ return !found; });
     }
     template <typename D, typename F>
     D collect(D z, F update) {
       D acc {z};
-      for (S& s : *source) {
-        acc = update(acc, s);
-      }
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) acc = update(acc, (*source)[i]);
+        return true;
+      });
       return acc;
     }
+    template <typename C = std::less<S>>
+    Pipe<S> sort(C compare = {}) & {
+      if constexpr (std::is_same_v<C,std::less<S>>) {
+        if (properties.order == Order::Ascending) return *this;
+        if (properties.order == Order::Descending) return reverse();
+      }
+      MemoryCharge charged {charge<S>(source->size())};
+      std::vector<S> result {*source};
+      std::sort(result.begin(), result.end(), compare);
+      return derive(std::move(result), sortedProperties<C>(), std::move(charged));
+    }
+    template <typename C = std::less<S>>
+    Pipe<S> sort(C compare = {}) && {
+      if constexpr (std::is_same_v<C,std::less<S>>) {
+        if (properties.order == Order::Ascending) return std::move(*this);
+        if (properties.order == Order::Descending) return std::move(*this).reverse();
+      }
+      if (!ownsSource()) return sort(compare);
+      std::sort(source->begin(), source->end(), compare);
+      return reuse(sortedProperties<C>());
+    }
+    template <typename D, typename A, typename C>
+    D reduce(D identity, A accumulate, C combine, Parallelism parallelism = {}) {
+      size_t chunkSize {std::max<size_t>(1, parallelism.chunkSize)};
+      size_t chunks {(source->size() + chunkSize - 1) / chunkSize};
+      if (!chunks) return identity;
+      std::vector<D> partials(chunks, identity);
+      std::atomic<size_t> stopped {chunks};
+      auto run = [&](size_t c) {
+        if (context.interruptible() && context.interruption() != Status::Completed) {
+          for (size_t seen {stopped}; c < seen && !stopped.compare_exchange_weak(seen, c);) {}
+          return;
+        }
+        D acc {identity};
+        size_t end {std::min(source->size(), (c + 1) * chunkSize)};
+        for (size_t i {c * chunkSize}; i!=end; i++) {
+          acc = accumulate(acc, (*source)[i]);
+        }
+        partials[c] = acc;
+      };
+      runParallel(chunks, parallelism.resolvedThreads(), run);
+      if (stopped != chunks) {
+        interrupted();
+        chunks = stopped;
+        if (!chunks) return identity;
+      }
+      for (size_t width {1}; width < chunks; width *= 2) {
+        for (size_t i {}; i + width < chunks; i += 2 * width) {
+          partials[i] = combine(partials[i], partials[i + width]);
+        }
+      }
+      return partials[0];
+    }
+    template <typename D, typename F>
+    D reduce(D identity, F op, Parallelism parallelism = {}) {
+      return reduce(identity, op, op, parallelism);
+    }
+    S sum(Parallelism parallelism = {}) {
+      if constexpr (std::is_floating_point_v<S>) {
+        return reduce(CompensatedSum<S> {},
+          [](CompensatedSum<S> acc, const S& s){ acc.add(s); return acc; },
+          [](CompensatedSum<S> a, const CompensatedSum<S>& b){ return a.merge(b); },
+          parallelism).value();
+      } else {
+        return reduce(S {}, [](const S& a, const S& b){ return a + b; }, parallelism);
+      }
+    }
     template <typename P>
     std::optional<S> find(P predicate) {
-      for (S& s : *source) {
-        if (predicate(s)) return s;
-      }
-      return std::nullopt;
+      size_t i {findIndex(predicate)};
+      if (i == source->size()) return std::nullopt;
+      return (*source)[i];
+    }
+    bool contains(const S& value) {
+      if (properties.order == Order::Ascending) return std::binary_search(source->begin(), source->end(), value);
+      if (properties.order == Order::Descending) return std::binary_search(source->rbegin(), source->rend(), value);
+      return std::find(source->begin(), source->end(), value) != source->end();
     }
     template <typename P>
     bool exists(P predicate) {
-      for (S& s : *source) {
-        if (predicate(s)) return true;
-      }
-      return false;
+      return findIndex(predicate) != source->size();
     }
     template <typename P>
     bool forAll(P predicate) {
-      for (S& s : *source) {
-        if (!predicate(s)) return false;
-      }
-      return true;
+      return findIndex([&predicate](S& s){ return !predicate(s); }) == source->size();
+    }
+    template <typename P>
+    Selection<S> select(P predicate) {
+      MemoryCharge charged {charge<size_t>(source->size())};
+      std::vector<size_t> indices {};
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) {
+          if (predicate((*source)[i])) indices.push_back(i);
+        }
+        return true;
+      });
+      charged.set(indices.capacity() * sizeof(size_t));
+      return {source, std::move(indices), properties, context, std::move(charged)};
     }
     template <typename K, typename F>
     std::map<K,std::vector<S>> groupBy(F groupKey) {
+      MemoryCharge charged {charge<S>(source->size())};
       std::map<K,std::vector<S>> result {};
-      for (S& s : *source) {
-        result[groupKey(s)].push_back(s);
-      }
+      forEach([&](S& s){ result[groupKey(s)].push_back(s); });
       return result;
     }
     std::optional<S> max() {
       if (!source->size()) return std::nullopt;
-      S& maxValue = (*source)[0];
-      for (S& s : *source) {
+      if (properties.order == Order::Ascending) return source->back();
+      if (properties.order == Order::Descending) return source->front();
+      S maxValue = (*source)[0];
+      for (const S& s : *source) {
         if (s > maxValue) maxValue = s;
       }
       return maxValue;
     }
     std::optional<S> min() {
       if (!source->size()) return std::nullopt;
-      S& minValue = (*source)[0];
-      for (S& s : *source) {
+      if (properties.order == Order::Ascending) return source->front();
+      if (properties.order == Order::Descending) return source->back();
+      S minValue = (*source)[0];
+      for (const S& s : *source) {
         if (s < minValue) minValue = s;
       }
       return minValue;
     }
+    Stats<S> stats() {
+      Stats<S> result {};
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) result.add((*source)[i], i);
+        return true;
+      });
+      return result;
+    }
+    template <typename D, typename F>
+    Stats<D> stats(F value) {
+      Stats<D> result {};
+      chunked(source->size(), [&](size_t begin, size_t end){
+        for (size_t i {begin}; i!=end; i++) result.add(value((*source)[i]), i);
+        return true;
+      });
+      return result;
+    }
+    template <typename K>
+    K sketch(K k) {
+      forEach([&k](const S& s){ k.add(s); });
+      return k;
+    }
+    size_t approxDistinct(int precision = 12) {
+      return std::llround(sketch(HyperLogLog<S> {precision}).estimate());
+    }
+    std::optional<S> approxQuantile(double q, size_t k = 200) {
+      return sketch(QuantileSketch<S> {k}).quantile(q);
+    }
+    std::vector<std::pair<S,size_t>> approxTopK(size_t n, size_t capacity = 1024) {
+      return sketch(HeavyHitters<S> {std::max(n, capacity)}).top(n);
+    }
     std::string join(std::string sep = "") {
       std::stringstream result {};
       bool first {true};
-      for (S& s : *source) {
+      forEach([&](S& s){
         if (!first) result << sep;
         first = false;
         result << s;
-      }
+      });
       return result.str();
     }
     template <typename P>
-    std::pair<std::vector<S>,std::vector<S>> partition(P predicate) {
-      std::vector<S> satisfies {};
-      std::vector<S> notSatisfies {};
-      for (S& s : *source) {
-        if (predicate(s)) {
-          satisfies.push_back(s);
-        } else {
-          notSatisfies.push_back(s);
-        }
+    std::pair<std::vector<S>,std::vector<S>> partition(P predicate) & {
+      MemoryCharge charged {charge<S>(source->size())};
+      size_t selected {};
+      std::vector<bool> keep {mask(predicate, selected)};
+      std::pair<std::vector<S>,std::vector<S>> result {};
+      result.first.reserve(selected);
+      result.second.reserve(keep.size() - selected);
+      for (size_t i {}; i!=keep.size(); i++) {
+        (keep[i] ? result.first : result.second).push_back((*source)[i]);
+      }
+      return result;
+    }
+    template <typename P>
+    std::pair<std::vector<S>,std::vector<S>> partition(P predicate) && {
+      if (!ownsSource()) return this->partition(predicate);
+      size_t selected {};
+      std::vector<bool> keep {mask(predicate, selected)};
+      std::pair<std::vector<S>,std::vector<S>> result {};
+      result.first.reserve(selected);
+      result.second.reserve(keep.size() - selected);
+      for (size_t i {}; i!=keep.size(); i++) {
+        (keep[i] ? result.first : result.second).push_back(std::move((*source)[i]));
       }
-      std::pair<std::vector<S>,std::vector<S>> result {satisfies, notSatisfies};
       return result;
     }
     size_t size() { return source->size(); }
@@ -192,12 +1177,103 @@ namespace pipes {
       std::copy(source->begin(), source->end(), result.begin());
       return result;
     }
+    template <typename C>
+    C& into(C& c) & {
+      append(c, source->begin(), source->end());
+      return c;
+    }
+    template <typename C>
+    C& into(C& c) && {
+      if (!ownsSource()) return into(c);
+      append(c, std::make_move_iterator(source->begin()), std::make_move_iterator(source->end()));
+      return c;
+    }
+    template <typename C>
+    C to() & {
+      C c {};
+      return std::move(into(c));
+    }
+    template <typename C>
+    C to() && {
+      if constexpr (std::is_same_v<C,std::vector<S>>) {
+        if (ownsSource()) return std::move(*source);
+      }
+      C c {};
+      return std::move(std::move(*this).into(c));
+    }
     std::set<S> toSet() const {
+      if (properties.order == Order::Descending) return std::set<S>(source->rbegin(), source->rend());
       std::set<S> result {};
       std::copy(source->begin(), source->end(), std::inserter(result, result.end()));
       return result;
     }
   };
+
+  // A filtered view over a pipe's source: only the indices of the chosen
+  // elements are stored, and elements are copied once, when the selection
+  // is materialized with toVector() or toPipe().
+  template <typename S>
+  class Selection {
+    template <typename> friend class Pipe;
+    VectorPtr<S> source;
+    std::vector<size_t> indices;
+    Properties properties;
+    Context context;
+    MemoryCharge charged;
+    Selection(VectorPtr<S> source, std::vector<size_t>&& indices, Properties properties, Context context, MemoryCharge&& charged)
+      : source {std::move(source)}, indices {std::move(indices)}, properties {properties}, context {context}, charged {std::move(charged)} {}
+  public:
+    template <typename P>
+    Selection<S> filter(P predicate) const & {
+      return Selection<S> {*this}.filter(predicate);
+    }
+    template <typename P>
+    Selection<S> filter(P predicate) && {
+      indices.erase(std::remove_if(indices.begin(), indices.end(), [&](size_t i){ return !predicate((*source)[i]); }), indices.end());
+      return std::move(*this);
+    }
+    template <typename F>
+    void forEach(F f) const {
+      for (size_t i : indices) f((*source)[i]);
+    }
+    template <typename D, typename F>
+    Pipe<D> map(F mapper) const {
+      MemoryCharge reserved {context.memory, indices.size() * sizeof(D)};
+      std::vector<D> result {};
+      result.reserve(indices.size());
+      for (size_t i : indices) result.push_back(mapper((*source)[i]));
+      return Pipe<D> {tracked(std::move(result), context, std::move(reserved)), Properties {}, context};
+    }
+    template <typename Z, typename F>
+    Z collect(Z z, F update) const {
+      for (size_t i : indices) z = update(z, (*source)[i]);
+      return z;
+    }
+    template <typename P>
+    std::optional<S> find(P predicate) const {
+      for (size_t i : indices) {
+        if (predicate((*source)[i])) return (*source)[i];
+      }
+      return std::nullopt;
+    }
+    template <typename P>
+    bool exists(P predicate) const {
+      return std::any_of(indices.begin(), indices.end(), [&](size_t i){ return predicate((*source)[i]); });
+    }
+    const std::vector<size_t>& getIndices() const { return indices; }
+    size_t size() const { return indices.size(); }
+    bool isEmpty() const { return indices.empty(); }
+    std::vector<S> toVector() const {
+      std::vector<S> result {};
+      result.reserve(indices.size());
+      for (size_t i : indices) result.push_back((*source)[i]);
+      return result;
+    }
+    Pipe<S> toPipe() const {
+      MemoryCharge reserved {context.memory, indices.size() * sizeof(S)};
+      return Pipe<S> {tracked(toVector(), context, std::move(reserved)), properties, context};
+    }
+  };
 }
 
 #endif
@@ -0,0 +1,142 @@
+#ifndef PIPES_PLAN_H
+#define PIPES_PLAN_H
+
+#include "pipes.h"
+
+namespace pipes {
+  // A plan is a chain of stages fused into one callable. Each stage takes
+  // an element and the next stage's sink, and returns false once no more
+  // input is wanted. Stage state (take/drop counters) is copied fresh for
+  // every run, so one plan can be applied to any number of inputs.
+  template <typename Chain, typename Sink, typename Input>
+  void runPlan(Chain chain, Sink& sink, Input& input) {
+    for (auto& s : input) {
+      if (!chain(s, sink)) break;
+    }
+  }
+
+  template <typename Chain, typename Z, typename F>
+  class CollectPlan {
+    Chain chain;
+    Z z;
+    F update;
+  public:
+    CollectPlan(Chain chain, Z z, F update) : chain {chain}, z {z}, update {update} {}
+    template <typename Input>
+    Z operator()(Input& input) const {
+      Z acc {z};
+      auto sink = [&](auto& d){ acc = update(acc, d); return true; };
+      runPlan(chain, sink, input);
+      return acc;
+    }
+  };
+
+  template <typename Chain, typename F>
+  class ForEachPlan {
+    Chain chain;
+    F f;
+  public:
+    ForEachPlan(Chain chain, F f) : chain {chain}, f {f} {}
+    template <typename Input>
+    void operator()(Input& input) {
+      auto sink = [&](auto& d){ f(d); return true; };
+      runPlan(chain, sink, input);
+    }
+  };
+
+  template <typename Chain, typename D>
+  class VectorPlan {
+    Chain chain;
+    std::vector<D> buffer {};
+  public:
+    VectorPlan(Chain chain, size_t reserve) : chain {chain} { buffer.reserve(reserve); }
+    template <typename Input>
+    void into(Input& input, std::vector<D>& out) const {
+      auto sink = [&](auto& d){ out.push_back(d); return true; };
+      runPlan(chain, sink, input);
+    }
+    template <typename Input>
+    const std::vector<D>& operator()(Input& input) {
+      buffer.clear();
+      into(input, buffer);
+      return buffer;
+    }
+  };
+
+  template <typename S, typename D, typename Chain>
+  class Plan {
+    Chain chain;
+    template <typename E, typename Stage>
+    auto then(Stage stage) const {
+      auto next = [chain = chain, stage](auto& s, auto& sink) mutable {
+        auto staged = [&stage, &sink](auto& d){ return stage(d, sink); };
+        return chain(s, staged);
+      };
+      return Plan<S,E,decltype(next)> {next};
+    }
+  public:
+    Plan(Chain chain) : chain {chain} {}
+    template <typename E, typename F>
+    auto map(F mapper) const {
+      return then<E>([mapper](auto& d, auto& sink){
+        E e {mapper(d)};
+        return sink(e);
+      });
+    }
+    template <typename F>
+    auto filter(F filter) const {
+      return then<D>([filter](auto& d, auto& sink){ return filter(d) ? sink(d) : true; });
+    }
+    template <typename E, typename F>
+    auto flatMap(F mapper) const {
+      return then<E>([mapper](auto& d, auto& sink){
+        for (auto&& e : mapper(d)) {
+          E item {e};
+          if (!sink(item)) return false;
+        }
+        return true;
+      });
+    }
+    auto take(int n) const {
+      return then<D>([n, seen = 0](auto& d, auto& sink) mutable {
+        if (seen >= n) return false;
+        seen++;
+        return sink(d) && seen < n;
+      });
+    }
+    auto drop(int n) const {
+      return then<D>([n, seen = 0](auto& d, auto& sink) mutable {
+        if (seen < n) {
+          seen++;
+          return true;
+        }
+        return sink(d);
+      });
+    }
+    template <typename P>
+    auto takeWhile(P predicate) const {
+      return then<D>([predicate](auto& d, auto& sink){ return predicate(d) && sink(d); });
+    }
+    template <typename P>
+    auto dropWhile(P predicate) const {
+      return then<D>([predicate, taking = false](auto& d, auto& sink) mutable {
+        if (!taking && predicate(d)) return true;
+        taking = true;
+        return sink(d);
+      });
+    }
+    template <typename Z, typename F>
+    CollectPlan<Chain,Z,F> collect(Z z, F update) const { return {chain, z, update}; }
+    template <typename F>
+    ForEachPlan<Chain,F> forEach(F f) const { return {chain, f}; }
+    VectorPlan<Chain,D> toVector(size_t reserve = 0) const { return {chain, reserve}; }
+  };
+
+  template <typename S>
+  auto plan() {
+    auto identity = [](auto& s, auto& sink){ return sink(s); };
+    return Plan<S,S,decltype(identity)> {identity};
+  }
+}
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef PIPES_SHARD_H
+#define PIPES_SHARD_H
+
+#include "pipes.h"
+#include "codec.h"
+
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+namespace pipes {
+  class ShardFailed : public std::runtime_error {
+  public:
+    size_t shard;
+    ShardFailed(size_t shard, const std::string& reason)
+      : std::runtime_error {"pipes: shard " + std::to_string(shard) + " failed: " + reason}, shard {shard} {}
+  };
+
+  namespace shard {
+    inline void writeAll(int fd, const char* data, size_t n) {
+      while (n) {
+        ssize_t written {::write(fd, data, n)};
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) ::_exit(3);
+        data += written;
+        n -= written;
+      }
+    }
+
+    inline std::vector<char> readAll(int fd) {
+      std::vector<char> bytes {};
+      char buffer[1 << 16];
+      for (;;) {
+        ssize_t got {::read(fd, buffer, sizeof buffer)};
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        bytes.insert(bytes.end(), buffer, buffer + got);
+      }
+      return bytes;
+    }
+
+    // Each worker sends one frame: a status byte, then either the
+    // encoded result or an error message.
+    template <typename R, typename F>
+    [[noreturn]] void runChild(int fd, F work) {
+      ByteWriter out {};
+      try {
+        R result {work()};
+        out.bytes.push_back(0);
+        Codec<R>::write(out, result);
+      } catch (std::exception& e) {
+        out.bytes.assign(1, 1);
+        Codec<std::string>::write(out, e.what());
+      } catch (...) {
+        out.bytes.assign(1, 1);
+        Codec<std::string>::write(out, "unknown exception");
+      }
+      writeAll(fd, out.bytes.data(), out.bytes.size());
+      ::close(fd);
+      ::_exit(0);
+    }
+  }
+
+  // Runs work on `shards` contiguous slices of the pipe, each in its own
+  // forked process, and folds the decoded results with merge in shard
+  // order. A shard that throws or dies takes down only its own process;
+  // the parent waits for every shard and then throws ShardFailed.
+  template <typename R, typename S, typename W, typename M>
+  R sharded(Pipe<S>& pipe, unsigned shards, W work, M merge) {
+    shards = std::max(1u, shards);
+    size_t total {pipe.size()};
+    std::vector<pid_t> pids {};
+    std::vector<int> fds {};
+    for (unsigned i {}; i!=shards; i++) {
+      int ends[2];
+      if (::pipe(ends)) throw std::runtime_error {"pipes: cannot create pipe"};
+      pid_t pid {::fork()};
+      if (pid < 0) {
+        ::close(ends[0]);
+        ::close(ends[1]);
+        for (int fd : fds) ::close(fd);
+        for (pid_t p : pids) ::waitpid(p, nullptr, 0);
+        throw std::runtime_error {"pipes: fork failed"};
+      }
+      if (pid == 0) {
+        ::close(ends[0]);
+        for (int fd : fds) ::close(fd);
+        size_t begin {total * i / shards};
+        size_t end {total * (i + 1) / shards};
+        shard::runChild<R>(ends[1], [&]() {
+          return work(pipe.drop(begin).take(end - begin));
+        });
+      }
+      ::close(ends[1]);
+      pids.push_back(pid);
+      fds.push_back(ends[0]);
+    }
+    std::vector<std::vector<char>> frames {};
+    std::optional<ShardFailed> failure {};
+    for (unsigned i {}; i!=shards; i++) {
+      frames.push_back(shard::readAll(fds[i]));
+      ::close(fds[i]);
+      int status {};
+      while (::waitpid(pids[i], &status, 0) < 0 && errno == EINTR) {}
+      if (failure) continue;
+      if (WIFSIGNALED(status)) {
+        failure.emplace(i, "killed by signal " + std::to_string(WTERMSIG(status)));
+      } else if (!WIFEXITED(status) || WEXITSTATUS(status) || frames[i].empty()) {
+        failure.emplace(i, "exited without a result");
+      } else if (frames[i][0]) {
+        ByteReader in {frames[i].data() + 1, frames[i].size() - 1};
+        failure.emplace(i, Codec<std::string>::read(in));
+      }
+    }
+    if (failure) throw *failure;
+    std::optional<R> result {};
+    for (auto& frame : frames) {
+      ByteReader in {frame.data() + 1, frame.size() - 1};
+      R partial {Codec<R>::read(in)};
+      if (result) {
+        result = merge(std::move(*result), std::move(partial));
+      } else {
+        result = std::move(partial);
+      }
+    }
+    return std::move(*result);
+  }
+}
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef PIPES_SINK_H
+#define PIPES_SINK_H
+
+#include "pipes.h"
+
+#include <cerrno>
+#include <cstring>
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace pipes {
+  struct SinkOptions {
+    size_t bufferSize {size_t {1} << 20};
+    size_t buffers {2};
+    bool direct {false};
+    size_t preallocate {};
+  };
+
+  // Fills one buffer while a background thread writes the previous ones,
+  // so formatting and I/O overlap. With direct set the file is opened with
+  // O_DIRECT when the filesystem allows it: buffers are page aligned, the
+  // last one is padded and the file is truncated back to its real length.
+  class AsyncFileWriter {
+    static constexpr size_t alignment {4096};
+    using Buffer = std::unique_ptr<char, void (*)(void*)>;
+    int fd {-1};
+    bool unbuffered {};
+    size_t capacity;
+    std::vector<Buffer> buffers {};
+    std::vector<size_t> used {};
+    size_t current {};
+    size_t written {};
+    std::deque<size_t> full {};
+    std::deque<size_t> empty {};
+    bool closing {};
+    std::string error {};
+    std::mutex mutex {};
+    std::condition_variable changed {};
+    std::thread writer {};
+    void writeBuffer(size_t b) {
+      size_t n {used[b]};
+      if (unbuffered) n = (n + alignment - 1) / alignment * alignment;
+      const char* data {buffers[b].get()};
+      while (n) {
+        ssize_t done {::write(fd, data, n)};
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) throw std::runtime_error {std::string {"pipes: write failed: "} + std::strerror(errno)};
+        data += done;
+        n -= done;
+      }
+    }
+    void run() {
+      std::unique_lock<std::mutex> lock {mutex};
+      for (;;) {
+        changed.wait(lock, [this]{ return !full.empty() || closing; });
+        if (full.empty()) return;
+        size_t b {full.front()};
+        full.pop_front();
+        if (error.empty()) {
+          lock.unlock();
+          std::string failure {};
+          try {
+            writeBuffer(b);
+          } catch (std::exception& e) {
+            failure = e.what();
+          }
+          lock.lock();
+          if (error.empty()) error = failure;
+        }
+        used[b] = 0;
+        empty.push_back(b);
+        changed.notify_all();
+      }
+    }
+    void submit() {
+      std::unique_lock<std::mutex> lock {mutex};
+      if (!error.empty()) throw std::runtime_error {error};
+      full.push_back(current);
+      changed.notify_all();
+      changed.wait(lock, [this]{ return !empty.empty(); });
+      current = empty.front();
+      empty.pop_front();
+    }
+  public:
+    AsyncFileWriter(const std::string& path, SinkOptions options = {})
+      : capacity {(std::max<size_t>(options.bufferSize, 1) + alignment - 1) / alignment * alignment} {
+      int flags {O_WRONLY | O_CREAT | O_TRUNC};
+      if (options.direct) {
+        fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        unbuffered = fd >= 0;
+      }
+      if (fd < 0) fd = ::open(path.c_str(), flags, 0644);
+      if (fd < 0) throw std::runtime_error {"pipes: cannot open " + path};
+      if (options.preallocate) ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, options.preallocate);
+      for (size_t i {}; i!=std::max<size_t>(options.buffers, 2); i++) {
+        Buffer buffer {static_cast<char*>(std::aligned_alloc(alignment, capacity)), std::free};
+        if (!buffer) {
+          ::close(fd);
+          throw std::bad_alloc {};
+        }
+        buffers.push_back(std::move(buffer));
+        used.push_back(0);
+        if (i) empty.push_back(i);
+      }
+      writer = std::thread {[this]{ run(); }};
+    }
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    ~AsyncFileWriter() {
+      try {
+        close();
+      } catch (...) {
+      }
+    }
+    void write(const void* data, size_t n) {
+      const char* bytes {static_cast<const char*>(data)};
+      while (n) {
+        size_t room {std::min(n, capacity - used[current])};
+        std::memcpy(buffers[current].get() + used[current], bytes, room);
+        used[current] += room;
+        written += room;
+        bytes += room;
+        n -= room;
+        if (used[current] == capacity) submit();
+      }
+    }
+    void write(std::string_view text) { write(text.data(), text.size()); }
+    void write(char c) { write(&c, 1); }
+    // Padding the last O_DIRECT block overshoots, so the length is fixed
+    // up once the writer thread is done.
+    void close() {
+      if (fd < 0) return;
+      {
+        std::lock_guard<std::mutex> lock {mutex};
+        if (used[current]) full.push_back(current);
+        closing = true;
+      }
+      changed.notify_all();
+      writer.join();
+      bool truncated {!unbuffered || ::ftruncate(fd, written) == 0};
+      int closed {::close(fd)};
+      fd = -1;
+      if (!error.empty()) throw std::runtime_error {error};
+      if (!truncated || closed) throw std::runtime_error {"pipes: cannot finish writing file"};
+    }
+    size_t bytesWritten() const { return written; }
+    bool direct() const { return unbuffered; }
+  };
+
+  template <typename S>
+  struct IsCharacter : std::bool_constant<std::is_same_v<S,char> || std::is_same_v<S,signed char> || std::is_same_v<S,unsigned char>
+    || std::is_same_v<S,wchar_t> || std::is_same_v<S,char16_t> || std::is_same_v<S,char32_t>> {};
+
+  // Formats s as join() does; only numbers take the to_chars fast path,
+  // so characters are written as characters.
+  template <typename S>
+  void formatTo(AsyncFileWriter& out, const S& s) {
+    if constexpr (std::is_integral_v<S> && !std::is_same_v<S,bool> && !IsCharacter<S>::value) {
+      char digits[24];
+      auto end = std::to_chars(digits, digits + sizeof digits, s).ptr;
+      out.write(digits, end - digits);
+    } else if constexpr (std::is_convertible_v<const S&, std::string_view>) {
+      out.write(std::string_view {s});
+    } else {
+      std::ostringstream text {};
+      text << s;
+      out.write(text.str());
+    }
+  }
+
+  // Writes each element with write(out, element) through an
+  // AsyncFileWriter and returns the number of bytes written.
+  template <typename S, typename F>
+  size_t writeFile(Pipe<S>& pipe, const std::string& path, F write, SinkOptions options = {}) {
+    AsyncFileWriter out {path, options};
+    pipe.forEach([&](const S& s){ write(out, s); });
+    out.close();
+    return out.bytesWritten();
+  }
+
+  template <typename S>
+  size_t writeLines(Pipe<S>& pipe, const std::string& path, SinkOptions options = {}) {
+    return writeFile(pipe, path, [](AsyncFileWriter& out, const S& s){
+      formatTo(out, s);
+      out.write('\n');
+    }, options);
+  }
+}
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef PIPES_SKETCHES_H
+#define PIPES_SKETCHES_H
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace pipes {
+  template <typename T>
+  struct Codec;
+
+  inline uint64_t mixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // Distinct count estimate in 2^precision bytes.
+  template <typename S, typename H = std::hash<S>>
+  class HyperLogLog {
+    template <typename> friend struct Codec;
+    int precision;
+    std::vector<uint8_t> registers;
+  public:
+    HyperLogLog(int p = 12) : precision {std::clamp(p, 4, 18)}, registers(size_t {1} << precision) {}
+    void add(const S& s) {
+      uint64_t h {mixHash(H {}(s))};
+      size_t index = h >> (64 - precision);
+      uint64_t rest {(h << precision) | (uint64_t {1} << (precision - 1))};
+      uint8_t rank = __builtin_clzll(rest) + 1;
+      registers[index] = std::max(registers[index], rank);
+    }
+    HyperLogLog<S,H>& merge(const HyperLogLog<S,H>& other) {
+      if (other.precision != precision) throw std::invalid_argument {"HyperLogLog precision mismatch"};
+      for (size_t i {}; i!=registers.size(); i++) {
+        registers[i] = std::max(registers[i], other.registers[i]);
+      }
+      return *this;
+    }
+    double estimate() const {
+      double m = registers.size();
+      double sum {};
+      size_t zeros {};
+      for (uint8_t r : registers) {
+        sum += std::ldexp(1.0, -r);
+        if (!r) zeros++;
+      }
+      double e {0.7213 / (1.0 + 1.079 / m) * m * m / sum};
+      if (e <= 2.5 * m && zeros) e = m * std::log(m / zeros);
+      return e;
+    }
+    int getPrecision() const { return precision; }
+    const std::vector<uint8_t>& getRegisters() const { return registers; }
+  };
+
+  // KLL quantile sketch: O(k) items retained, compactions alternate
+  // between odd and even offsets so results are reproducible.
+  template <typename S, typename C = std::less<S>>
+  class QuantileSketch {
+    template <typename> friend struct Codec;
+    size_t k;
+    size_t n {};
+    bool odd {};
+    std::vector<std::vector<S>> levels = std::vector<std::vector<S>>(1);
+    size_t capacity(size_t level) const {
+      size_t depth {levels.size() - level - 1};
+      return std::max<size_t>(2, std::ceil(k * std::pow(2.0 / 3.0, depth)));
+    }
+    void compress() {
+      for (size_t h {}; h!=levels.size(); h++) {
+        if (levels[h].size() < capacity(h)) continue;
+        if (h+1 == levels.size()) levels.emplace_back();
+        std::vector<S>& level = levels[h];
+        std::sort(level.begin(), level.end(), C {});
+        size_t paired {level.size() / 2 * 2};
+        for (size_t i = odd; i < paired; i += 2) {
+          levels[h+1].push_back(level[i]);
+        }
+        odd = !odd;
+        level.erase(level.begin(), level.begin() + paired);
+      }
+    }
+  public:
+    QuantileSketch(size_t k = 200) : k {std::max<size_t>(k, 8)} {}
+    void add(const S& s) {
+      n++;
+      levels[0].push_back(s);
+      if (levels[0].size() >= capacity(0)) compress();
+    }
+    QuantileSketch<S,C>& merge(const QuantileSketch<S,C>& other) {
+      if (other.k != k) throw std::invalid_argument {"QuantileSketch size mismatch"};
+      if (other.levels.size() > levels.size()) levels.resize(other.levels.size());
+      for (size_t h {}; h!=other.levels.size(); h++) {
+        levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+      }
+      n += other.n;
+      compress();
+      return *this;
+    }
+    std::optional<S> quantile(double q) const {
+      std::vector<std::pair<S,size_t>> weighted {};
+      for (size_t h {}; h!=levels.size(); h++) {
+        for (const S& s : levels[h]) weighted.emplace_back(s, size_t {1} << h);
+      }
+      if (weighted.empty()) return std::nullopt;
+      std::sort(weighted.begin(), weighted.end(), [](auto& a, auto& b){ return C {}(a.first, b.first); });
+      size_t total {};
+      for (auto& w : weighted) total += w.second;
+      double target {std::clamp(q, 0.0, 1.0) * total};
+      size_t seen {};
+      for (auto& w : weighted) {
+        seen += w.second;
+        if (seen >= target) return w.first;
+      }
+      return weighted.back().first;
+    }
+    size_t count() const { return n; }
+    size_t retained() const {
+      size_t total {};
+      for (auto& level : levels) total += level.size();
+      return total;
+    }
+  };
+
+  // Misra-Gries frequent items: at most `capacity` counters are kept and
+  // every reported count is low by no more than maximumError().
+  template <typename S, typename H = std::hash<S>>
+  class HeavyHitters {
+    template <typename> friend struct Codec;
+    size_t capacity;
+    size_t offset {};
+    std::unordered_map<S,size_t,H> counters {};
+    void purge() {
+      while (counters.size() > capacity) {
+        std::vector<size_t> counts {};
+        counts.reserve(counters.size());
+        for (auto& c : counters) counts.push_back(c.second);
+        auto middle = counts.begin() + counts.size() / 2;
+        std::nth_element(counts.begin(), middle, counts.end());
+        size_t cut {*middle};
+        offset += cut;
+        for (auto it = counters.begin(); it != counters.end();) {
+          if (it->second <= cut) {
+            it = counters.erase(it);
+          } else {
+            it->second -= cut;
+            ++it;
+          }
+        }
+      }
+    }
+  public:
+    HeavyHitters(size_t capacity = 1024) : capacity {std::max<size_t>(capacity, 2)} {
+      counters.reserve(this->capacity + 1);
+    }
+    void add(const S& s, size_t weight = 1) {
+      counters[s] += weight;
+      if (counters.size() > capacity) purge();
+    }
+    HeavyHitters<S,H>& merge(const HeavyHitters<S,H>& other) {
+      for (auto& c : other.counters) counters[c.first] += c.second;
+      offset += other.offset;
+      purge();
+      return *this;
+    }
+    std::vector<std::pair<S,size_t>> top(size_t k) const {
+      std::vector<std::pair<S,size_t>> result {counters.begin(), counters.end()};
+      std::sort(result.begin(), result.end(), [](auto& a, auto& b){ return a.second > b.second; });
+      if (result.size() > k) result.erase(result.begin() + k, result.end());
+      return result;
+    }
+    size_t maximumError() const { return offset; }
+  };
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef PIPES_SPILL_H
+#define PIPES_SPILL_H
+
+#include "binary.h"
+
+#include <filesystem>
+#include <queue>
+#include <unistd.h>
+
+namespace pipes {
+  struct SpillOptions {
+    size_t memoryBudget {size_t {256} << 20};
+    std::string directory {};
+  };
+
+  template <typename T>
+  size_t footprint(const T&) { return sizeof(T); }
+  inline size_t footprint(const std::string& s) { return sizeof s + s.capacity(); }
+  template <typename A, typename B>
+  size_t footprint(const std::pair<A,B>& p) {
+    return footprint(p.first) + footprint(p.second) + sizeof p - sizeof p.first - sizeof p.second;
+  }
+
+  // Shared by every sorter in the process so run files never collide.
+  inline size_t nextRunId() {
+    static std::atomic<size_t> counter {};
+    return counter++;
+  }
+
+  // Sorts any number of elements in a bounded buffer: once the buffer
+  // passes the memory budget it is sorted and written out as a run, and
+  // forEach() streams a k-way merge of the runs. Runs are written in
+  // chunks of about a sixteenth of the budget and a merge reads at most
+  // fanIn of them at once, merging groups of runs into longer ones first
+  // when there are more. Equal elements keep their insertion order.
+  template <typename T, typename C = std::less<T>>
+  class ExternalSorter {
+    static constexpr size_t fanIn {15};
+    SpillOptions options;
+    C less;
+    std::vector<T> buffer {};
+    size_t bufferBytes {};
+    size_t chunkSize {};
+    std::vector<std::string> runs {};
+    size_t spilled {};
+    std::string runPath() const {
+      std::filesystem::path directory {options.directory.empty()
+        ? std::filesystem::temp_directory_path() : std::filesystem::path {options.directory}};
+      return (directory / ("pipes-spill-" + std::to_string(::getpid()) + "-" + std::to_string(nextRunId()) + ".bin")).string();
+    }
+    void spill() {
+      if (buffer.empty()) return;
+      std::stable_sort(buffer.begin(), buffer.end(), less);
+      runs.push_back(runPath());
+      spilled++;
+      if (!chunkSize) chunkSize = std::max<size_t>(64, buffer.size() / 16);
+      BinaryWriter<T,false> writer {runs.back(), chunkSize};
+      for (const T& t : buffer) writer.add(t);
+      writer.close();
+      buffer.clear();
+      bufferBytes = 0;
+    }
+    struct Cursor {
+      BinaryFile<T> file;
+      size_t chunk {};
+      size_t pos {};
+      std::vector<T> items {};
+      bool next() {
+        if (++pos < items.size()) return true;
+        items.clear();
+        pos = 0;
+        while (items.empty() && chunk < file.chunkCount()) file.readChunk(chunk++, items);
+        return !items.empty();
+      }
+    };
+    // Merges runs [begin, end), ties going to the earlier run.
+    template <typename F>
+    void merge(size_t begin, size_t end, F f) {
+      std::vector<Cursor> cursors {};
+      cursors.reserve(end - begin);
+      for (size_t r {begin}; r!=end; r++) {
+        cursors.push_back(Cursor {BinaryFile<T> {runs[r]}});
+        cursors.back().next();
+      }
+      auto later = [&](size_t a, size_t b) {
+        const T& x {cursors[a].items[cursors[a].pos]};
+        const T& y {cursors[b].items[cursors[b].pos]};
+        return less(y, x) || (!less(x, y) && a > b);
+      };
+      std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap {later};
+      for (size_t i {}; i!=cursors.size(); i++) {
+        if (!cursors[i].items.empty()) heap.push(i);
+      }
+      while (!heap.empty()) {
+        size_t i {heap.top()};
+        heap.pop();
+        f(cursors[i].items[cursors[i].pos]);
+        if (cursors[i].next()) heap.push(i);
+      }
+    }
+    // Replaces each group of fanIn consecutive runs with their merge, so
+    // runs stay in insertion order.
+    void mergePass() {
+      std::vector<std::string> merged {};
+      for (size_t begin {}; begin < runs.size(); begin += fanIn) {
+        size_t end {std::min(runs.size(), begin + fanIn)};
+        merged.push_back(runPath());
+        BinaryWriter<T,false> writer {merged.back(), chunkSize};
+        merge(begin, end, [&writer](const T& t){ writer.add(t); });
+        writer.close();
+        for (size_t r {begin}; r!=end; r++) std::filesystem::remove(runs[r]);
+      }
+      runs = std::move(merged);
+    }
+  public:
+    ExternalSorter(SpillOptions options = {}, C less = {}) : options {std::move(options)}, less {less} {}
+    ExternalSorter(const ExternalSorter&) = delete;
+    ~ExternalSorter() {
+      for (auto& run : runs) {
+        std::error_code ignored {};
+        std::filesystem::remove(run, ignored);
+      }
+    }
+    void add(T t) {
+      bufferBytes += footprint(t);
+      buffer.push_back(std::move(t));
+      if (bufferBytes >= options.memoryBudget) spill();
+    }
+    size_t spilledRuns() const { return spilled; }
+    template <typename F>
+    void forEach(F f) {
+      if (runs.empty()) {
+        std::stable_sort(buffer.begin(), buffer.end(), less);
+        for (T& t : buffer) f(t);
+        return;
+      }
+      spill();
+      std::vector<T>().swap(buffer);
+      while (runs.size() > fanIn) mergePass();
+      merge(0, runs.size(), f);
+    }
+  };
+
+  template <typename S, typename F, typename C = std::less<S>>
+  void forEachSorted(Pipe<S>& pipe, F f, SpillOptions options = {}, C less = {}) {
+    ExternalSorter<S,C> sorter {std::move(options), less};
+    pipe.forEach([&sorter](const S& s){ sorter.add(s); });
+    sorter.forEach(f);
+  }
+
+  template <typename S, typename F>
+  void forEachDistinct(Pipe<S>& pipe, F f, SpillOptions options = {}) {
+    std::optional<S> last {};
+    forEachSorted(pipe, [&](S& s){
+      if (last && !(*last < s)) return;
+      f(s);
+      last = s;
+    }, std::move(options));
+  }
+
+  template <typename K, typename S, typename KF, typename F>
+  void forEachGroup(Pipe<S>& pipe, KF groupKey, F onGroup, SpillOptions options = {}) {
+    using Entry = std::pair<K,S>;
+    auto byKey = [](const Entry& a, const Entry& b){ return a.first < b.first; };
+    ExternalSorter<Entry,decltype(byKey)> sorter {std::move(options), byKey};
+    pipe.forEach([&](const S& s){ sorter.add(Entry {groupKey(s), s}); });
+    std::optional<K> key {};
+    std::vector<S> group {};
+    sorter.forEach([&](Entry& entry){
+      if (key && *key < entry.first) {
+        onGroup(*key, group);
+        group.clear();
+      }
+      key = entry.first;
+      group.push_back(std::move(entry.second));
+    });
+    if (key) onGroup(*key, group);
+  }
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef PIPES_TEXT_H
+#define PIPES_TEXT_H
+
+#include "pipes.h"
+
+#include <cstring>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace pipes {
+  // Everything here hands out string_views into the caller's text, so the
+  // buffer (or MappedFile) must outlive the pipes built from it. Delimiters
+  // are found with memchr, which the C library vectorizes.
+  template <typename F>
+  void forEachField(std::string_view text, char delimiter, F f) {
+    const char* begin {text.data()};
+    const char* end {begin + text.size()};
+    while (begin != end) {
+      const char* found {static_cast<const char*>(std::memchr(begin, delimiter, end - begin))};
+      if (!found) {
+        f(std::string_view {begin, static_cast<size_t>(end - begin)});
+        return;
+      }
+      f(std::string_view {begin, static_cast<size_t>(found - begin)});
+      begin = found + 1;
+      if (begin == end) f(std::string_view {begin, 0});
+    }
+  }
+
+  // Every field between delimiters, including empty ones.
+  inline Pipe<std::string_view> split(std::string_view text, char delimiter) {
+    std::vector<std::string_view> result {};
+    forEachField(text, delimiter, [&result](std::string_view field){ result.push_back(field); });
+    return Pipe<std::string_view> {std::move(result)};
+  }
+
+  // Only the non-empty fields, so runs of delimiters count as one.
+  inline Pipe<std::string_view> tokenize(std::string_view text, char delimiter = ' ') {
+    std::vector<std::string_view> result {};
+    forEachField(text, delimiter, [&result](std::string_view field){
+      if (!field.empty()) result.push_back(field);
+    });
+    return Pipe<std::string_view> {std::move(result)};
+  }
+
+  // Newline separated lines without their terminators; a final newline
+  // does not start another line and a trailing '\r' is dropped.
+  inline Pipe<std::string_view> lines(std::string_view text) {
+    if (!text.empty() && text.back() == '\n') text.remove_suffix(1);
+    std::vector<std::string_view> result {};
+    if (text.empty()) return Pipe<std::string_view> {std::move(result)};
+    forEachField(text, '\n', [&result](std::string_view line){
+      if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+      result.push_back(line);
+    });
+    return Pipe<std::string_view> {std::move(result)};
+  }
+
+  // Stages for flatMap<std::string_view>: split or tokenize every element.
+  inline auto split(char delimiter) {
+    return [delimiter](std::string_view text, Emitter<std::string_view> out){
+      forEachField(text, delimiter, out);
+    };
+  }
+
+  inline auto tokenize(char delimiter = ' ') {
+    return [delimiter](std::string_view text, Emitter<std::string_view> out){
+      forEachField(text, delimiter, [&out](std::string_view field){
+        if (!field.empty()) out(field);
+      });
+    };
+  }
+
+  class MappedFile {
+    const char* data {};
+    size_t length {};
+  public:
+    MappedFile(const std::string& path) {
+      int fd {::open(path.c_str(), O_RDONLY)};
+      if (fd < 0) throw std::runtime_error {"pipes: cannot open " + path};
+      struct stat info {};
+      if (::fstat(fd, &info)) {
+        ::close(fd);
+        throw std::runtime_error {"pipes: cannot stat " + path};
+      }
+      length = info.st_size;
+      if (length) {
+        void* mapped {::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0)};
+        if (mapped == MAP_FAILED) {
+          ::close(fd);
+          throw std::runtime_error {"pipes: cannot map " + path};
+        }
+        ::madvise(mapped, length, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapped);
+      }
+      ::close(fd);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) : data {std::exchange(other.data, nullptr)}, length {std::exchange(other.length, 0)} {}
+    ~MappedFile() {
+      if (data) ::munmap(const_cast<char*>(data), length);
+    }
+    std::string_view text() const { return {data, length}; }
+    size_t size() const { return length; }
+  };
+}
+
+#endif
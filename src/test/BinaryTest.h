@@ -0,0 +1,108 @@
+#include <cxxtest/TestSuite.h>
+#include "../pipes/binary.h"
+
+#include <iostream>
+#include <filesystem>
+
+using namespace pipes;
+using IntVector = std::vector<int>;
+using StringVector = std::vector<std::string>;
+
+class BinaryTestSuite : public CxxTest::TestSuite {
+  std::string path {(std::filesystem::temp_directory_path() / "pipes_binary_test.bin").string()};
+public:
+  void tearDown() {
+    std::filesystem::remove(path);
+  }
+
+  void testBinaryRoundTrip(void) {
+    IntVector v {};
+    for (int i {}; i!=1000; i++) v.push_back(i * 3 - 500);
+    Pipe<int> pipe {v};
+    writeBinary(pipe, path, 100);
+    BinaryFile<int> file {path};
+    TS_ASSERT_EQUALS(file.chunkCount(), 10);
+    TS_ASSERT_EQUALS(file.size(), 1000);
+    TS_ASSERT_EQUALS(file.readAll().toVector(), v);
+    TS_ASSERT_EQUALS(file.readAll(4).toVector(), v);
+  }
+
+  void testBinaryCompactIntegers(void) {
+    IntVector v {};
+    for (int i {}; i!=10000; i++) v.push_back(1000000 + i);
+    Pipe<int> pipe {v};
+    writeBinary(pipe, path);
+    TS_ASSERT_LESS_THAN(std::filesystem::file_size(path), 10100);
+  }
+
+  void testBinaryEmpty(void) {
+    IntVector v {};
+    Pipe<int> pipe {v};
+    writeBinary(pipe, path);
+    BinaryFile<int> file {path};
+    TS_ASSERT_EQUALS(file.chunkCount(), 0);
+    TS_ASSERT(file.readAll().isEmpty());
+  }
+
+  void testBinaryChunkStats(void) {
+    IntVector v {5, 1, 9, 20, 30, 25};
+    Pipe<int> pipe {v};
+    writeBinary(pipe, path, 3);
+    BinaryFile<int> file {path};
+    TS_ASSERT_EQUALS(file.chunk(0).min, 1);
+    TS_ASSERT_EQUALS(file.chunk(0).max, 9);
+    TS_ASSERT_EQUALS(file.chunk(1).min, 20);
+    TS_ASSERT_EQUALS(file.chunk(1).max, 30);
+    IntVector second = file.readChunk(1);
+    TS_ASSERT_EQUALS(second, IntVector({20, 30, 25}));
+  }
+
+  void testBinarySkipChunks(void) {
+    IntVector v {5, 1, 9, 20, 30, 25};
+    Pipe<int> pipe {v};
+    writeBinary(pipe, path, 3);
+    BinaryFile<int> file {path};
+    int chunksRead {};
+    Pipe<int> high = file.read([&chunksRead](int, int max){ chunksRead++; return max > 10; });
+    TS_ASSERT_EQUALS(chunksRead, 2);
+    TS_ASSERT_EQUALS(high.toVector(), IntVector({20, 30, 25}));
+    TS_ASSERT_EQUALS(file.readBetween(8, 21).toVector(), IntVector({9, 20}));
+  }
+
+  void testBinaryStrings(void) {
+    StringVector v {"alpha", "", "gamma", "delta"};
+    Pipe<std::string> pipe {v};
+    writeBinary(pipe, path, 2);
+    BinaryFile<std::string> file {path};
+    TS_ASSERT_EQUALS(file.readAll().toVector(), v);
+    TS_ASSERT_EQUALS(file.chunk(1).min, "delta");
+  }
+
+  void testBinaryDoubles(void) {
+    std::vector<double> v {1.5, -2.25, 1e300};
+    Pipe<double> pipe {v};
+    writeBinary(pipe, path);
+    BinaryFile<double> file {path};
+    TS_ASSERT_EQUALS(file.readAll().toVector(), v);
+  }
+
+  void testBinaryNotPipesFile(void) {
+    std::ofstream {path} << "hello, world";
+    TS_ASSERT_THROWS(BinaryFile<int> {path}, std::runtime_error);
+  }
+
+  void testCodecNested(void) {
+    std::map<std::string,std::vector<long>> m {{"a", {1, -2, 3}}, {"b", {}}};
+    TS_ASSERT_EQUALS(decode<decltype(m)>(encode(m)), m);
+    std::pair<int,std::string> p {-7, "x"};
+    TS_ASSERT_EQUALS(decode<decltype(p)>(encode(p)), p);
+  }
+
+  void testCodecSketches(void) {
+    HeavyHitters<std::string> hitters {4};
+    for (int i {}; i!=100; i++) hitters.add(i % 2 ? "odd" : std::to_string(i));
+    HeavyHitters<std::string> copy {decode<HeavyHitters<std::string>>(encode(hitters))};
+    TS_ASSERT_EQUALS(copy.top(1), hitters.top(1));
+    TS_ASSERT_EQUALS(copy.maximumError(), hitters.maximumError());
+  }
+};
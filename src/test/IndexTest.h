@@ -0,0 +1,106 @@
+#include <cxxtest/TestSuite.h>
+#include "../pipes/index.h"
+
+#include <iostream>
+#include <string_view>
+
+using namespace pipes;
+using IntVector = std::vector<int>;
+using StringVector = std::vector<std::string>;
+
+struct FirstLetter {
+  size_t operator()(const std::string& s) const { return s.empty() ? 0 : s[0]; }
+};
+
+class IndexTestSuite : public CxxTest::TestSuite {
+  template <typename S>
+  static std::vector<S> items(Slice<S> slice) { return {slice.begin(), slice.end()}; }
+public:
+  void testHashIndex(void) {
+    IntVector v {15, 2, 25, 7, 5, 12};
+    Pipe<int> pipe {v};
+    HashIndex<int,int> index {indexBy<int>(pipe, [](int i){return i%10;})};
+    TS_ASSERT_EQUALS(index.size(), 3);
+    TS_ASSERT_EQUALS(items(index.find(5)), IntVector({15, 25, 5}));
+    TS_ASSERT_EQUALS(items(index.find(2)), IntVector({2, 12}));
+    TS_ASSERT(index.find(3).empty());
+    TS_ASSERT(!index.contains(0));
+  }
+
+  void testHashIndexHeterogeneous(void) {
+    StringVector v {"apple", "avocado", "banana"};
+    Pipe<std::string> pipe {v};
+    auto index = indexBy<std::string>(pipe, [](const std::string& s){return s.substr(0, 1);});
+    TS_ASSERT_EQUALS(index.find(std::string_view {"a"}).size(), 2);
+    TS_ASSERT(index.contains(std::string {"b"}));
+    TS_ASSERT_EQUALS(index.find("a").size(), 2);
+    const char* keys[] {"a", "c", "b"};
+    size_t found {};
+    index.findAll(std::begin(keys), std::end(keys), [&](const char*, Slice<std::string> slice){ found += slice.size(); });
+    TS_ASSERT_EQUALS(found, 3);
+  }
+
+  void testHashIndexCustomHash(void) {
+    StringVector v {"apple", "avocado", "banana"};
+    Pipe<std::string> pipe {v};
+    HashIndex<std::string,std::string,FirstLetter> index {pipe, [](const std::string& s){return s;}};
+    TS_ASSERT_EQUALS(index.find(std::string_view {"banana"}).size(), 1);
+    TS_ASSERT_EQUALS(index.find("avocado").size(), 1);
+    TS_ASSERT(!index.contains("cherry"));
+  }
+
+  void testHashIndexBatched(void) {
+    IntVector v {};
+    for (int i {}; i!=5000; i++) v.push_back(i);
+    Pipe<int> pipe {v};
+    auto index = indexBy<int>(pipe, [](int i){return i/2;});
+    IntVector queries {};
+    for (int q {-10}; q!=2600; q+=3) queries.push_back(q);
+    size_t calls {};
+    index.findAll(queries.begin(), queries.end(), [&](int q, Slice<int> found){
+      TS_ASSERT_EQUALS(queries[calls++], q);
+      TS_ASSERT_EQUALS(found.size(), q >= 0 && q < 2500 ? 2 : 0);
+      if (!found.empty()) TS_ASSERT_EQUALS(*found.begin(), q * 2);
+    });
+    TS_ASSERT_EQUALS(calls, queries.size());
+  }
+
+  void testSortedIndex(void) {
+    IntVector v {30, 10, 20, 10, 40};
+    Pipe<int> pipe {v};
+    IntVector positions {0, 1, 2, 3, 4};
+    Pipe<int> ids {positions};
+    auto index = sortedIndexBy<int>(ids, [&](int i){return v[i];});
+    TS_ASSERT_EQUALS(index.size(), 4);
+    TS_ASSERT_EQUALS(items(index.find(10)), IntVector({1, 3}));
+    TS_ASSERT_EQUALS(items(index.find(40)), IntVector({4}));
+    TS_ASSERT(index.find(25).empty());
+    TS_ASSERT(index.find(50).empty());
+    TS_ASSERT(index.find(0).empty());
+    TS_ASSERT_EQUALS(items(index.between(15, 30)), IntVector({2, 0}));
+    TS_ASSERT_EQUALS(items(index.between(0, 100)).size(), 5);
+    TS_ASSERT(index.between(41, 100).empty());
+    TS_ASSERT(index.between(30, 15).empty());
+  }
+
+  void testSortedIndexBatched(void) {
+    IntVector v {};
+    for (int i {}; i!=1000; i++) v.push_back((i * 7919) % 1000 * 2);
+    Pipe<int> pipe {v};
+    auto index = sortedIndexBy<int>(pipe, [](int i){return i;});
+    IntVector queries {};
+    for (int q {-5}; q!=2010; q++) queries.push_back(q);
+    size_t hits {};
+    index.findAll(queries.begin(), queries.end(), [&](int q, Slice<int> found){
+      TS_ASSERT_EQUALS(found.size(), q >= 0 && q < 2000 && q % 2 == 0 ? 1 : 0);
+      TS_ASSERT_EQUALS(index.find(q).size(), found.size());
+      hits += found.size();
+    });
+    TS_ASSERT_EQUALS(hits, 1000);
+    IntVector none {};
+    Pipe<int> empty {none};
+    auto emptyIndex = sortedIndexBy<int>(empty, [](int i){return i;});
+    emptyIndex.findAll(queries.begin(), queries.begin() + 3, [](int, Slice<int> found){ TS_ASSERT(found.empty()); });
+    TS_ASSERT(emptyIndex.between(0, 10).empty());
+  }
+};
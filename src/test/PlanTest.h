@@ -0,0 +1,84 @@
+#include <cxxtest/TestSuite.h>
+#include "../pipes/plan.h"
+
+#include <iostream>
+
+using namespace pipes;
+using IntVector = std::vector<int>;
+using IntSet = std::set<int>;
+
+class PlanTestSuite : public CxxTest::TestSuite {
+public:
+  void testPlanCollect(void) {
+    auto sumOfDoubledEvens = plan<int>()
+      .filter([](int i){return i%2==0;})
+      .map<int>([](int i){return i*2;})
+      .collect(0, [](int z, int i){return z+i;});
+    IntVector v {1, 2, 3, 4, 5};
+    IntSet s {10, 11};
+    TS_ASSERT_EQUALS(sumOfDoubledEvens(v), 12);
+    TS_ASSERT_EQUALS(sumOfDoubledEvens(s), 20);
+    TS_ASSERT_EQUALS(sumOfDoubledEvens(v), 12);
+  }
+
+  void testPlanMatchesPipe(void) {
+    IntVector v {5, 3, 8, 1, 9, 2, 7};
+    auto steps = plan<int>()
+      .dropWhile([](int i){return i>2;})
+      .map<int>([](int i){return i*10;})
+      .takeWhile([](int i){return i<80;});
+    IntVector expected = Pipe<int> {v}
+      .dropWhile([](int i){return i>2;})
+      .map<int>([](int i){return i*10;})
+      .takeWhile([](int i){return i<80;})
+      .toVector();
+    auto toVector = steps.toVector();
+    TS_ASSERT_EQUALS(toVector(v), expected);
+  }
+
+  void testPlanReusesBuffer(void) {
+    auto doubled = plan<int>().map<int>([](int i){return i*2;}).toVector(8);
+    IntVector first {1, 2, 3};
+    IntVector second {4, 5};
+    const int* data {doubled(first).data()};
+    TS_ASSERT_EQUALS(doubled(first), IntVector({2, 4, 6}));
+    TS_ASSERT_EQUALS(doubled(second), IntVector({8, 10}));
+    TS_ASSERT_EQUALS(doubled(second).data(), data);
+  }
+
+  void testPlanTakeDropReset(void) {
+    auto middle = plan<int>().drop(1).take(2).toVector();
+    IntVector v {1, 2, 3, 4, 5};
+    TS_ASSERT_EQUALS(middle(v), IntVector({2, 3}));
+    TS_ASSERT_EQUALS(middle(v), IntVector({2, 3}));
+  }
+
+  void testPlanTakeStopsEarly(void) {
+    int seen {};
+    auto firstTwo = plan<int>().filter([&seen](int){ seen++; return true; }).take(2).toVector();
+    IntVector v {1, 2, 3, 4, 5};
+    TS_ASSERT_EQUALS(firstTwo(v).size(), 2);
+    TS_ASSERT_EQUALS(seen, 2);
+  }
+
+  void testPlanFlatMap(void) {
+    auto repeated = plan<int>().flatMap<int>([](int i){return IntVector(i, i);}).collect(0, [](int z, int){return z+1;});
+    IntVector v {1, 2, 3, 4, 5};
+    TS_ASSERT_EQUALS(repeated(v), 15);
+  }
+
+  void testPlanOnPipe(void) {
+    IntVector v {1, 2, 3, 4, 5};
+    Pipe<int> pipe {v};
+    int sum {};
+    auto add = plan<int>().filter([](int i){return i>2;}).forEach([&sum](int i){ sum += i; });
+    add(pipe);
+    TS_ASSERT_EQUALS(sum, 12);
+  }
+
+  void testPlanEmpty(void) {
+    auto count = plan<int>().collect(0, [](int z, int){return z+1;});
+    IntVector v {};
+    TS_ASSERT_EQUALS(count(v), 0);
+  }
+};
@@ -291,4 +291,56 @@ public:
     IntSet reverse = pipe.reverse().toSet();
     TS_ASSERT_EQUALS(reverse.size(), 5);
   }
+
+  void testSetSorted(void) {
+    IntSet s {3, 1, 5, 2, 4};
+    Pipe<int> pipe {s};
+    TS_ASSERT(pipe.getProperties().order == Order::Ascending);
+    TS_ASSERT(pipe.getProperties().unique);
+    Pipe<int> evens = pipe.filter([](int i){return i%2==0;}).drop(0).take(5);
+    TS_ASSERT(evens.getProperties().order == Order::Ascending);
+    TS_ASSERT(evens.getProperties().unique);
+  }
+
+  void testSetMapLosesOrder(void) {
+    IntSet s {1, 2, 3};
+    Pipe<int> pipe {s};
+    TS_ASSERT(pipe.map<int>([](int i){return -i;}).getProperties().order == Order::None);
+  }
+
+  void testSetReverseDescending(void) {
+    IntSet s {1, 2, 3, 4, 5};
+    Pipe<int> pipe {s};
+    Pipe<int> reversed = pipe.reverse();
+    TS_ASSERT(reversed.getProperties().order == Order::Descending);
+    TS_ASSERT_EQUALS(reversed.max(), 5);
+    TS_ASSERT_EQUALS(reversed.min(), 1);
+    TS_ASSERT_EQUALS(reversed.toSet(), s);
+    TS_ASSERT_EQUALS(reversed.sort().toVector(), IntVector({1, 2, 3, 4, 5}));
+    TS_ASSERT(reversed.contains(4));
+    TS_ASSERT(!reversed.contains(6));
+  }
+
+  void testSetMinMaxSorted(void) {
+    IntSet s {3, 1, 5, 2, 4};
+    Pipe<int> pipe {s};
+    TS_ASSERT_EQUALS(pipe.dropWhile([](int i){return i<2;}).min(), 2);
+    TS_ASSERT_EQUALS(pipe.takeWhile([](int i){return i<4;}).max(), 3);
+  }
+
+  void testSetContains(void) {
+    IntSet s {1, 3, 5, 7, 9};
+    Pipe<int> pipe {s};
+    TS_ASSERT(pipe.contains(7));
+    TS_ASSERT(!pipe.contains(4));
+    TS_ASSERT(!pipe.contains(10));
+  }
+
+  void testSetSortNoOp(void) {
+    IntSet s {3, 1, 2};
+    Pipe<int> pipe {s};
+    TS_ASSERT_EQUALS(pipe.sort().toVector(), IntVector({1, 2, 3}));
+    TS_ASSERT(pipe.sort(std::greater<int> {}).getProperties().order == Order::None);
+    TS_ASSERT_EQUALS(pipe.sort(std::greater<int> {}).toVector(), IntVector({3, 2, 1}));
+  }
 };
@@ -0,0 +1,90 @@
+#include <cxxtest/TestSuite.h>
+#include "../pipes/shard.h"
+
+#include <iostream>
+#include <csignal>
+
+using namespace pipes;
+using IntVector = std::vector<int>;
+using IntGroups = std::map<int,std::vector<int>>;
+
+class ShardTestSuite : public CxxTest::TestSuite {
+  IntVector numbers(int n) {
+    IntVector v {};
+    for (int i {}; i!=n; i++) v.push_back(i);
+    return v;
+  }
+public:
+  void testShardedSum(void) {
+    Pipe<int> pipe {numbers(10000)};
+    long sum {sharded<long>(pipe, 4,
+      [](Pipe<int> shard){ return shard.collect(0L, [](long z, int i){return z+i;}); },
+      [](long a, long b){ return a+b; })};
+    TS_ASSERT_EQUALS(sum, 49995000L);
+  }
+
+  void testShardedKeepsOrder(void) {
+    Pipe<int> pipe {numbers(10)};
+    IntVector all {sharded<IntVector>(pipe, 3,
+      [](Pipe<int> shard){ return shard.toVector(); },
+      [](IntVector a, IntVector b){ a.insert(a.end(), b.begin(), b.end()); return a; })};
+    TS_ASSERT_EQUALS(all, numbers(10));
+  }
+
+  void testShardedMoreShardsThanElements(void) {
+    Pipe<int> pipe {numbers(2)};
+    size_t count {sharded<size_t>(pipe, 5,
+      [](Pipe<int> shard){ return shard.size(); },
+      [](size_t a, size_t b){ return a+b; })};
+    TS_ASSERT_EQUALS(count, 2);
+  }
+
+  void testShardedGroupBy(void) {
+    Pipe<int> pipe {numbers(1000)};
+    IntGroups groups {sharded<IntGroups>(pipe, 4,
+      [](Pipe<int> shard){ return shard.groupBy<int>([](int i){ return i % 3; }); },
+      [](IntGroups a, IntGroups b){
+        for (auto& [key, group] : b) a[key].insert(a[key].end(), group.begin(), group.end());
+        return a;
+      })};
+    TS_ASSERT_EQUALS(groups, pipe.groupBy<int>([](int i){ return i % 3; }));
+  }
+
+  void testShardedSketches(void) {
+    IntVector v {};
+    for (int i {}; i!=40000; i++) v.push_back(i % 10000);
+    Pipe<int> pipe {v};
+    HyperLogLog<int> distinct {sharded<HyperLogLog<int>>(pipe, 4,
+      [](Pipe<int> shard){ return shard.sketch(HyperLogLog<int> {}); },
+      [](HyperLogLog<int> a, HyperLogLog<int> b){ return a.merge(b); })};
+    TS_ASSERT_LESS_THAN(9500, distinct.estimate());
+    TS_ASSERT_LESS_THAN(distinct.estimate(), 10500);
+    QuantileSketch<int> quantiles {sharded<QuantileSketch<int>>(pipe, 4,
+      [](Pipe<int> shard){ return shard.sketch(QuantileSketch<int> {}); },
+      [](QuantileSketch<int> a, QuantileSketch<int> b){ return a.merge(b); })};
+    TS_ASSERT_EQUALS(quantiles.count(), 40000);
+    TS_ASSERT_LESS_THAN(4500, *quantiles.quantile(0.5));
+    TS_ASSERT_LESS_THAN(*quantiles.quantile(0.5), 5500);
+  }
+
+  void testShardedException(void) {
+    Pipe<int> pipe {numbers(100)};
+    try {
+      sharded<int>(pipe, 4,
+        [](Pipe<int> shard) -> int { if (shard.exists([](int i){ return i == 60; })) throw std::runtime_error {"bad input"}; return 0; },
+        [](int a, int b){ return a+b; });
+      TS_FAIL("expected ShardFailed");
+    } catch (ShardFailed& e) {
+      TS_ASSERT_EQUALS(e.shard, 2);
+      TS_ASSERT(std::string {e.what()}.find("bad input") != std::string::npos);
+    }
+  }
+
+  void testShardedCrashIsolated(void) {
+    Pipe<int> pipe {numbers(100)};
+    TS_ASSERT_THROWS(sharded<int>(pipe, 2,
+      [](Pipe<int> shard) -> int { if (!shard.exists([](int i){ return i == 0; })) std::raise(SIGKILL); return 1; },
+      [](int a, int b){ return a+b; }), ShardFailed);
+    TS_ASSERT_EQUALS(pipe.size(), 100);
+  }
+};
@@ -0,0 +1,71 @@
+#include <cxxtest/TestSuite.h>
+#include "../pipes/sink.h"
+
+#include <iostream>
+#include <filesystem>
+
+using namespace pipes;
+using IntVector = std::vector<int>;
+
+class SinkTestSuite : public CxxTest::TestSuite {
+  std::string path {(std::filesystem::temp_directory_path() / "pipes_sink_test.txt").string()};
+  std::string contents() {
+    std::ifstream in {path, std::ios::binary};
+    return {std::istreambuf_iterator<char> {in}, std::istreambuf_iterator<char> {}};
+  }
+public:
+  void tearDown() {
+    std::filesystem::remove(path);
+  }
+
+  void testSinkLines(void) {
+    IntVector v {1, -20, 300};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(writeLines(pipe, path), 10);
+    TS_ASSERT_EQUALS(contents(), "1\n-20\n300\n");
+    std::vector<std::string> words {"a", "bc"};
+    Pipe<std::string> strings {words};
+    writeLines(strings, path);
+    TS_ASSERT_EQUALS(contents(), "a\nbc\n");
+  }
+
+  void testSinkCharacters(void) {
+    std::vector<char> letters {'a', 'b'};
+    Pipe<char> pipe {letters};
+    writeLines(pipe, path);
+    TS_ASSERT_EQUALS(contents(), "a\nb\n");
+    std::vector<unsigned char> bytes {'x'};
+    Pipe<unsigned char> raw {bytes};
+    writeLines(raw, path);
+    TS_ASSERT_EQUALS(contents(), raw.join() + "\n");
+  }
+
+  void testSinkManyBuffers(void) {
+    IntVector v {};
+    std::string expected {};
+    for (int i {}; i!=100000; i++) {
+      v.push_back(i);
+      expected += std::to_string(i) + "\n";
+    }
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(writeLines(pipe, path, SinkOptions {4096, 3}), expected.size());
+    TS_ASSERT_EQUALS(contents(), expected);
+  }
+
+  void testSinkDirectAndPreallocated(void) {
+    IntVector v(5000, 7);
+    Pipe<int> pipe {v};
+    SinkOptions options {4096, 2, true, 1 << 20};
+    size_t bytes {writeFile(pipe, path, [](AsyncFileWriter& out, int i){ out.write(&i, sizeof i); }, options)};
+    TS_ASSERT_EQUALS(bytes, 5000 * sizeof(int));
+    TS_ASSERT_EQUALS(std::filesystem::file_size(path), bytes);
+    std::string written {contents()};
+    int last {};
+    std::memcpy(&last, written.data() + bytes - sizeof last, sizeof last);
+    TS_ASSERT_EQUALS(last, 7);
+  }
+
+  void testSinkCannotOpen(void) {
+    TS_ASSERT_THROWS(AsyncFileWriter {"/nonexistent/dir/file"}, std::runtime_error);
+  }
+};
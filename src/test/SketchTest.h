@@ -0,0 +1,107 @@
+#include <cxxtest/TestSuite.h>
+#include "../pipes/pipes.h"
+
+#include <iostream>
+
+using namespace pipes;
+using IntVector = std::vector<int>;
+
+class SketchTestSuite : public CxxTest::TestSuite {
+public:
+  void testApproxDistinct(void) {
+    IntVector v {};
+    for (int i {}; i!=100000; i++) v.push_back(i % 20000);
+    Pipe<int> pipe {v};
+    size_t distinct {pipe.approxDistinct()};
+    TS_ASSERT_LESS_THAN(19000, distinct);
+    TS_ASSERT_LESS_THAN(distinct, 21000);
+  }
+
+  void testApproxDistinctSmall(void) {
+    IntVector v {1, 2, 3, 2, 1};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(pipe.approxDistinct(), 3);
+  }
+
+  void testApproxDistinctEmpty(void) {
+    IntVector v {};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(pipe.approxDistinct(), 0);
+  }
+
+  void testHyperLogLogMerge(void) {
+    IntVector v {};
+    for (int i {}; i!=50000; i++) v.push_back(i);
+    Pipe<int> pipe {v};
+    HyperLogLog<int> low = pipe.take(30000).sketch(HyperLogLog<int> {});
+    HyperLogLog<int> high = pipe.drop(20000).sketch(HyperLogLog<int> {});
+    double merged {low.merge(high).estimate()};
+    TS_ASSERT_LESS_THAN(47500, merged);
+    TS_ASSERT_LESS_THAN(merged, 52500);
+  }
+
+  void testApproxQuantile(void) {
+    IntVector v {};
+    for (int i {}; i!=100000; i++) v.push_back((i * 7919) % 100000);
+    Pipe<int> pipe {v};
+    int median {*pipe.approxQuantile(0.5)};
+    TS_ASSERT_LESS_THAN(48000, median);
+    TS_ASSERT_LESS_THAN(median, 52000);
+    int p99 {*pipe.approxQuantile(0.99)};
+    TS_ASSERT_LESS_THAN(97000, p99);
+  }
+
+  void testApproxQuantileExact(void) {
+    IntVector v {5, 1, 4, 2, 3};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(pipe.approxQuantile(0.0), 1);
+    TS_ASSERT_EQUALS(pipe.approxQuantile(0.5), 3);
+    TS_ASSERT_EQUALS(pipe.approxQuantile(1.0), 5);
+  }
+
+  void testApproxQuantileEmpty(void) {
+    IntVector v {};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(pipe.approxQuantile(0.5), std::nullopt);
+  }
+
+  void testQuantileSketchBounded(void) {
+    QuantileSketch<int> sketch {};
+    for (int i {}; i!=1000000; i++) sketch.add(i);
+    TS_ASSERT_EQUALS(sketch.count(), 1000000);
+    TS_ASSERT_LESS_THAN(sketch.retained(), 1000);
+  }
+
+  void testQuantileSketchMerge(void) {
+    QuantileSketch<int> low {};
+    QuantileSketch<int> high {};
+    for (int i {}; i!=50000; i++) low.add(i);
+    for (int i {50000}; i!=100000; i++) high.add(i);
+    int median {*low.merge(high).quantile(0.5)};
+    TS_ASSERT_LESS_THAN(48000, median);
+    TS_ASSERT_LESS_THAN(median, 52000);
+  }
+
+  void testApproxTopK(void) {
+    IntVector v {};
+    for (int i {}; i!=100000; i++) v.push_back(i % 3 == 0 ? 7 : i % 5 == 0 ? 11 : i);
+    Pipe<int> pipe {v};
+    auto top = pipe.approxTopK(2, 64);
+    TS_ASSERT_EQUALS(top.size(), 2);
+    TS_ASSERT_EQUALS(top[0].first, 7);
+    TS_ASSERT_EQUALS(top[1].first, 11);
+  }
+
+  void testHeavyHittersMerge(void) {
+    HeavyHitters<int> left {16};
+    HeavyHitters<int> right {16};
+    for (int i {}; i!=1000; i++) left.add(i % 2 ? 1 : i);
+    for (int i {}; i!=1000; i++) right.add(i % 2 ? 2 : -i);
+    auto top = left.merge(right).top(2);
+    TS_ASSERT_EQUALS(top.size(), 2);
+    TS_ASSERT(top[0].first == 1 || top[0].first == 2);
+    TS_ASSERT(top[1].first == 1 || top[1].first == 2);
+    TS_ASSERT_LESS_THAN_EQUALS(top[0].second, 500);
+    TS_ASSERT_LESS_THAN_EQUALS(500 - left.maximumError(), top[1].second);
+  }
+};
@@ -0,0 +1,137 @@
+#include <cxxtest/TestSuite.h>
+#include "../pipes/spill.h"
+
+#include <iostream>
+
+using namespace pipes;
+using IntPair = std::pair<int,int>;
+using IntVector = std::vector<int>;
+using IntPairVector = std::vector<IntPair>;
+
+class SpillTestSuite : public CxxTest::TestSuite {
+  IntVector shuffled(int n) {
+    IntVector v {};
+    for (int i {}; i!=n; i++) v.push_back((i * 7919) % n);
+    return v;
+  }
+public:
+  void testSort(void) {
+    IntVector v {3, 1, 2};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(pipe.sort().toVector(), IntVector({1, 2, 3}));
+    TS_ASSERT_EQUALS(pipe.sort(std::greater<int> {}).toVector(), IntVector({3, 2, 1}));
+    TS_ASSERT_EQUALS(pipe.toVector(), v);
+  }
+
+  void testSortedInMemory(void) {
+    Pipe<int> pipe {shuffled(1000)};
+    IntVector out {};
+    forEachSorted(pipe, [&out](int i){ out.push_back(i); });
+    TS_ASSERT_EQUALS(out.size(), 1000);
+    TS_ASSERT(std::is_sorted(out.begin(), out.end()));
+  }
+
+  void testSortedSpills(void) {
+    ExternalSorter<int> sorter {SpillOptions {1024}};
+    for (int i : shuffled(10000)) sorter.add(i);
+    TS_ASSERT_LESS_THAN(30, sorter.spilledRuns());
+    IntVector out {};
+    sorter.forEach([&out](int i){ out.push_back(i); });
+    TS_ASSERT_EQUALS(out.size(), 10000);
+    TS_ASSERT_EQUALS(out.front(), 0);
+    TS_ASSERT_EQUALS(out.back(), 9999);
+    TS_ASSERT(std::is_sorted(out.begin(), out.end()));
+  }
+
+  void testSortedSpillsStable(void) {
+    IntPairVector pairs {};
+    for (int i {}; i!=2000; i++) pairs.push_back({(i * 31) % 10, i});
+    Pipe<IntPair> pipe {pairs};
+    IntPairVector out {};
+    forEachSorted(pipe, [&out](const IntPair& p){ out.push_back(p); }, SpillOptions {2048},
+      [](const IntPair& a, const IntPair& b){ return a.first < b.first; });
+    TS_ASSERT_EQUALS(out.size(), 2000);
+    for (size_t i {1}; i!=out.size(); i++) {
+      TS_ASSERT(out[i-1].first < out[i].first || (out[i-1].first == out[i].first && out[i-1].second < out[i].second));
+    }
+  }
+
+  void testSpillFilesRemoved(void) {
+    std::string directory {(std::filesystem::temp_directory_path() / "pipes_spill_test").string()};
+    std::filesystem::create_directories(directory);
+    {
+      ExternalSorter<int> sorter {SpillOptions {256, directory}};
+      for (int i : shuffled(1000)) sorter.add(i);
+      TS_ASSERT(!std::filesystem::is_empty(directory));
+    }
+    TS_ASSERT(std::filesystem::is_empty(directory));
+    std::filesystem::remove(directory);
+  }
+
+  void testSortedSpillsMultiPass(void) {
+    std::string directory {(std::filesystem::temp_directory_path() / "pipes_spill_passes").string()};
+    std::filesystem::create_directories(directory);
+    {
+      auto byFirst = [](const IntPair& a, const IntPair& b){ return a.first < b.first; };
+      ExternalSorter<IntPair,decltype(byFirst)> sorter {SpillOptions {512, directory}, byFirst};
+      for (int i {}; i!=20000; i++) sorter.add({(i * 7919) % 50, i});
+      TS_ASSERT_LESS_THAN(225, sorter.spilledRuns());
+      IntPairVector out {};
+      sorter.forEach([&out](const IntPair& p){ out.push_back(p); });
+      TS_ASSERT_EQUALS(out.size(), 20000);
+      for (size_t i {1}; i!=out.size(); i++) {
+        TS_ASSERT(out[i-1].first < out[i].first || (out[i-1].first == out[i].first && out[i-1].second < out[i].second));
+      }
+      size_t files {};
+      for (auto& entry : std::filesystem::directory_iterator {directory}) files += entry.is_regular_file();
+      TS_ASSERT_LESS_THAN_EQUALS(files, 15);
+    }
+    TS_ASSERT(std::filesystem::is_empty(directory));
+    std::filesystem::remove(directory);
+  }
+
+  void testSortersShareDirectory(void) {
+    std::string directory {(std::filesystem::temp_directory_path() / "pipes_spill_shared").string()};
+    std::filesystem::create_directories(directory);
+    {
+      ExternalSorter<unsigned> unsigneds {SpillOptions {64, directory}};
+      ExternalSorter<long> longs {SpillOptions {64, directory}};
+      for (unsigned i {}; i!=100; i++) {
+        unsigneds.add(99 - i);
+        longs.add(1000L + i);
+      }
+      std::vector<unsigned> unsignedOut {};
+      std::vector<long> longOut {};
+      unsigneds.forEach([&unsignedOut](unsigned i){ unsignedOut.push_back(i); });
+      longs.forEach([&longOut](long l){ longOut.push_back(l); });
+      TS_ASSERT_EQUALS(unsignedOut.size(), 100);
+      TS_ASSERT_EQUALS(longOut.size(), 100);
+      TS_ASSERT_EQUALS(unsignedOut.back(), 99u);
+      TS_ASSERT_EQUALS(longOut.front(), 1000L);
+      TS_ASSERT(std::is_sorted(unsignedOut.begin(), unsignedOut.end()));
+    }
+    std::filesystem::remove_all(directory);
+  }
+
+  void testDistinctSpills(void) {
+    IntVector v {};
+    for (int i {}; i!=5000; i++) v.push_back(i % 300);
+    Pipe<int> pipe {v};
+    IntVector out {};
+    forEachDistinct(pipe, [&out](int i){ out.push_back(i); }, SpillOptions {1024});
+    TS_ASSERT_EQUALS(out.size(), 300);
+    TS_ASSERT(std::is_sorted(out.begin(), out.end()));
+  }
+
+  void testGroupSpills(void) {
+    IntVector v {};
+    for (int i {}; i!=5000; i++) v.push_back(i);
+    Pipe<int> pipe {v};
+    std::map<int,std::vector<int>> expected {pipe.groupBy<int>([](int i){ return i % 7; })};
+    std::map<int,std::vector<int>> groups {};
+    forEachGroup<int>(pipe, [](int i){ return i % 7; }, [&groups](int key, std::vector<int>& group){
+      groups[key] = group;
+    }, SpillOptions {4096});
+    TS_ASSERT_EQUALS(groups, expected);
+  }
+};
@@ -0,0 +1,60 @@
+#include <cxxtest/TestSuite.h>
+#include "../pipes/text.h"
+
+#include <iostream>
+#include <filesystem>
+
+using namespace pipes;
+using ViewVector = std::vector<std::string_view>;
+
+class TextTestSuite : public CxxTest::TestSuite {
+  std::string path {(std::filesystem::temp_directory_path() / "pipes_text_test.log").string()};
+public:
+  void tearDown() {
+    std::filesystem::remove(path);
+  }
+
+  void testTextLines(void) {
+    std::string text {"GET /a 200\r\nPOST /b 500\n\nGET /c 404\n"};
+    Pipe<std::string_view> pipe {lines(text)};
+    TS_ASSERT_EQUALS(pipe.toVector(), ViewVector({"GET /a 200", "POST /b 500", "", "GET /c 404"}));
+    TS_ASSERT_EQUALS(pipe.toVector()[0].data(), text.data());
+    TS_ASSERT(lines("").isEmpty());
+    TS_ASSERT_EQUALS(lines("one").toVector(), ViewVector({"one"}));
+  }
+
+  void testTextSplit(void) {
+    TS_ASSERT_EQUALS(split("a,,b,", ',').toVector(), ViewVector({"a", "", "b", ""}));
+    TS_ASSERT_EQUALS(split("abc", ',').toVector(), ViewVector({"abc"}));
+    TS_ASSERT(split("", ',').isEmpty());
+  }
+
+  void testTextTokenize(void) {
+    TS_ASSERT_EQUALS(tokenize("  GET   /a  200 ").toVector(), ViewVector({"GET", "/a", "200"}));
+    TS_ASSERT(tokenize("   ").isEmpty());
+  }
+
+  void testTextStages(void) {
+    std::string text {"GET /a 200\nPOST /b 500\nGET /c 500\n"};
+    Pipe<std::string_view> words = lines(text).flatMap<std::string_view>(tokenize(' '));
+    TS_ASSERT_EQUALS(words.size(), 9);
+    auto byStatus = lines(text).groupBy<std::string_view>([](std::string_view line){ return line.substr(line.rfind(' ') + 1); });
+    TS_ASSERT_EQUALS(byStatus["500"].size(), 2);
+    Pipe<std::string_view> fields = split("a:b\nc", '\n').flatMap<std::string_view>(split(':'));
+    TS_ASSERT_EQUALS(fields.toVector(), ViewVector({"a", "b", "c"}));
+  }
+
+  void testTextMappedFile(void) {
+    {
+      std::ofstream out {path};
+      out << "first\nsecond\nthird\n";
+    }
+    MappedFile file {path};
+    TS_ASSERT_EQUALS(file.size(), 19);
+    TS_ASSERT_EQUALS(lines(file.text()).filter([](std::string_view line){ return line.size() > 5; }).toVector(), ViewVector({"second"}));
+    std::ofstream {path, std::ios::trunc};
+    MappedFile empty {path};
+    TS_ASSERT(lines(empty.text()).isEmpty());
+    TS_ASSERT_THROWS(MappedFile {path + ".missing"}, std::runtime_error);
+  }
+};
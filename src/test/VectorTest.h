@@ -2,12 +2,28 @@
 #include "../pipes/pipes.h"
 
 #include <iostream>
+#include <deque>
+#include <list>
+#include <unordered_set>
 
 using namespace pipes;
 using IntPair = std::pair<int,int>;
 using IntVector = std::vector<int>;
 using IntPairVector = std::vector<IntPair>;
 
+struct StringRange {
+  std::string* first {};
+  std::string* last {};
+  std::string* begin() const { return first; }
+  std::string* end() const { return last; }
+};
+
+struct Meters {
+  int value;
+  explicit Meters(int value) : value {value} {}
+  bool operator==(const Meters& other) const { return value == other.value; }
+};
+
 class VectorTestSuite : public CxxTest::TestSuite {
 public:
   void testVector(void) {
@@ -341,4 +357,599 @@ public:
     TS_ASSERT_EQUALS(reverse[3], 2);
     TS_ASSERT_EQUALS(reverse[4], 1);
   }
+
+  void testVectorZipWithShorter(void) {
+    IntVector v {1, 2, 3, 4, 5};
+    IntVector w {10, 20, 30};
+    Pipe<int> pipe {v};
+    IntVector products = pipe.zipWith<int>(Pipe<int> {w}, [](int a, int b){return a*b;}).toVector();
+    TS_ASSERT_EQUALS(products, IntVector({10, 40, 90}));
+  }
+
+  void testVectorZipWith(void) {
+    IntVector v {1, 2, 3, 4, 5};
+    IntVector w {10, 20, 30, 40, 50};
+    Pipe<int> pipe {v};
+    IntVector sums = pipe.zipWith<int>(Pipe<int> {w}, [](int a, int b){return a+b;}).toVector();
+    TS_ASSERT_EQUALS(sums.size(), 5);
+    TS_ASSERT_EQUALS(sums[0], 11);
+    TS_ASSERT_EQUALS(sums[4], 55);
+  }
+
+  void testVectorZipWithEmpty(void) {
+    IntVector v {1, 2, 3, 4, 5};
+    IntVector w {};
+    Pipe<int> pipe {v};
+    TS_ASSERT(pipe.zipWith<int>(Pipe<int> {w}, [](int a, int b){return a+b;}).isEmpty());
+  }
+
+  void testVectorMapIndexed(void) {
+    IntVector v {5, 6, 7};
+    Pipe<int> pipe {v};
+    IntVector weighted = pipe.mapIndexed<int>([](size_t i, int s){return int(i)*s;}).toVector();
+    TS_ASSERT_EQUALS(weighted.size(), 3);
+    TS_ASSERT_EQUALS(weighted[0], 0);
+    TS_ASSERT_EQUALS(weighted[1], 6);
+    TS_ASSERT_EQUALS(weighted[2], 14);
+  }
+
+  void testVectorMaxKeepsSource(void) {
+    IntVector v {1, 5, 2};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(pipe.max(), 5);
+    TS_ASSERT_EQUALS(pipe.min(), 1);
+    IntVector after = pipe.toVector();
+    TS_ASSERT_EQUALS(after[0], 1);
+    TS_ASSERT_EQUALS(after[1], 5);
+  }
+
+  void testVectorStats(void) {
+    IntVector v {2, 4, 4, 4, 5, 5, 7, 9};
+    Pipe<int> pipe {v};
+    Stats<int> stats = pipe.stats();
+    TS_ASSERT_EQUALS(stats.count, 8);
+    TS_ASSERT_DELTA(stats.sum, 40.0, 1e-9);
+    TS_ASSERT_DELTA(stats.mean, 5.0, 1e-9);
+    TS_ASSERT_DELTA(stats.variance(), 4.0, 1e-9);
+    TS_ASSERT_EQUALS(stats.min, 2);
+    TS_ASSERT_EQUALS(stats.max, 9);
+    TS_ASSERT_EQUALS(stats.argMin, 0);
+    TS_ASSERT_EQUALS(stats.argMax, 7);
+  }
+
+  void testVectorStatsNone(void) {
+    IntVector v {};
+    Pipe<int> pipe {v};
+    Stats<int> stats = pipe.stats();
+    TS_ASSERT_EQUALS(stats.count, 0);
+    TS_ASSERT_EQUALS(stats.min, std::nullopt);
+    TS_ASSERT_EQUALS(stats.max, std::nullopt);
+  }
+
+  void testVectorStatsMerge(void) {
+    IntVector v {2, 4, 4, 4, 5, 5, 7, 9};
+    Pipe<int> pipe {v};
+    Stats<int> whole = pipe.stats();
+    Stats<int> part = pipe.take(3).stats();
+    part.merge(pipe.drop(3).stats());
+    TS_ASSERT_EQUALS(part.count, whole.count);
+    TS_ASSERT_DELTA(part.mean, whole.mean, 1e-9);
+    TS_ASSERT_DELTA(part.variance(), whole.variance(), 1e-9);
+    TS_ASSERT_EQUALS(part.min, whole.min);
+    TS_ASSERT_EQUALS(part.argMin, whole.argMin);
+    TS_ASSERT_EQUALS(part.argMax, whole.argMax);
+    IntVector first {1, 2, 3};
+    IntVector second {4, 5};
+    Stats<int> joined = Pipe<int> {first}.stats();
+    joined.merge(Pipe<int> {second}.stats());
+    TS_ASSERT_EQUALS(joined.argMin, 0);
+    TS_ASSERT_EQUALS(joined.argMax, 4);
+    IntVector low {5, 1};
+    IntVector tied {1, 5, 0};
+    Stats<int> ties = Pipe<int> {low}.stats();
+    ties.merge(Pipe<int> {IntVector {1, 5}}.stats());
+    TS_ASSERT_EQUALS(ties.argMin, 1);
+    TS_ASSERT_EQUALS(ties.argMax, 0);
+    ties.merge(Pipe<int> {tied}.stats());
+    TS_ASSERT_EQUALS(ties.argMin, 6);
+    TS_ASSERT_EQUALS(ties.argMax, 0);
+  }
+
+  void testVectorStatsProjected(void) {
+    IntPairVector pairs {{1, 2}, {5, 7}, {2, 8}};
+    Pipe<IntPair> pipe {pairs};
+    Stats<int> seconds = pipe.stats<int>([](IntPair p){ return p.second; });
+    TS_ASSERT_EQUALS(seconds.count, 3);
+    TS_ASSERT_EQUALS(seconds.max, 8);
+    TS_ASSERT_EQUALS(seconds.argMax, 2);
+  }
+
+  void testVectorReduce(void) {
+    IntVector v {1, 2, 3, 4, 5};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(pipe.reduce(0, [](int a, int b){return a+b;}), 15);
+  }
+
+  void testVectorReduceEmpty(void) {
+    IntVector v {};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(pipe.reduce(1, [](int a, int b){return a*b;}), 1);
+  }
+
+  void testVectorReduceParallel(void) {
+    IntVector v(10007, 3);
+    Pipe<int> pipe {v};
+    long total {pipe.reduce(0L, [](long z, int i){return z+i;}, [](long a, long b){return a+b;}, Parallelism {64, 4})};
+    TS_ASSERT_EQUALS(total, 30021L);
+  }
+
+  void testVectorReduceDeterministic(void) {
+    std::vector<double> v {};
+    for (int i {}; i!=100000; i++) v.push_back(1.0 / (i + 1) * (i % 2 ? -1e8 : 1e8));
+    Pipe<double> pipe {v};
+    auto add = [](double a, double b){return a+b;};
+    double one {pipe.reduce(0.0, add, Parallelism {1000, 1})};
+    double many {pipe.reduce(0.0, add, Parallelism {1000, 8})};
+    TS_ASSERT_EQUALS(one, many);
+  }
+
+  void testVectorSum(void) {
+    IntVector v {1, 2, 3, 4, 5};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(pipe.sum(), 15);
+  }
+
+  void testVectorSumCompensated(void) {
+    std::vector<double> v {1.0};
+    for (int i {}; i!=10000; i++) v.push_back(1e-16);
+    Pipe<double> pipe {v};
+    TS_ASSERT_DELTA(pipe.sum(Parallelism {100, 4}), 1.0 + 1e-12, 1e-15);
+  }
+
+  void testVectorInPlaceChain(void) {
+    IntVector v {1, 2, 3, 4, 5, 6, 7, 8};
+    Pipe<int> pipe {v};
+    const int* before {};
+    pipe.forEach([&before](int& i){ if (!before) before = &i; });
+    Pipe<int> result = std::move(pipe)
+      .map<int>([](int i){return i*3;})
+      .filter([](int i){return i%2==0;})
+      .dropWhile([](int i){return i<10;})
+      .takeWhile([](int i){return i<100;})
+      .drop(1)
+      .take(1)
+      .reverse();
+    const int* after {};
+    result.forEach([&after](int& i){ if (!after) after = &i; });
+    TS_ASSERT_EQUALS(after, before);
+    IntVector out = result.toVector();
+    TS_ASSERT_EQUALS(out.size(), 1);
+    TS_ASSERT_EQUALS(out[0], 18);
+  }
+
+  void testVectorInPlaceSharedUntouched(void) {
+    auto shared = std::make_shared<IntVector>(IntVector {1, 2, 3, 4, 5});
+    IntVector evens = Pipe<int> {shared}.filter([](int i){return i%2==0;}).reverse().toVector();
+    TS_ASSERT_EQUALS(evens.size(), 2);
+    TS_ASSERT_EQUALS(evens[0], 4);
+    TS_ASSERT_EQUALS(shared->size(), 5);
+    TS_ASSERT_EQUALS((*shared)[0], 1);
+  }
+
+  void testVectorInPlaceNamedPipeUntouched(void) {
+    IntVector v {1, 2, 3, 4, 5};
+    Pipe<int> pipe {v};
+    IntVector firstTwo = pipe.take(2).toVector();
+    IntVector doubled = pipe.map<int>([](int i){return i*2;}).toVector();
+    TS_ASSERT_EQUALS(firstTwo.size(), 2);
+    TS_ASSERT_EQUALS(pipe.size(), 5);
+    TS_ASSERT_EQUALS(doubled[4], 10);
+    TS_ASSERT_EQUALS(pipe.toVector()[4], 5);
+  }
+
+  void testVectorFlatMapArray(void) {
+    IntVector v {1, 2, 3};
+    Pipe<int> pipe {v};
+    IntVector pairs = pipe.flatMap<int>([](int i){return std::array<int,2> {i, -i};}).toVector();
+    TS_ASSERT_EQUALS(pairs.size(), 6);
+    TS_ASSERT_EQUALS(pairs[0], 1);
+    TS_ASSERT_EQUALS(pairs[1], -1);
+    TS_ASSERT_EQUALS(pairs[5], -3);
+  }
+
+  void testVectorFlatMapBorrowed(void) {
+    std::vector<IntVector> table {{}, {1}, {2, 2}};
+    IntVector v {2, 0, 1};
+    Pipe<int> pipe {v};
+    IntVector flat = pipe.flatMap<int>([&table](int i) -> IntVector& {return table[i];}).toVector();
+    TS_ASSERT_EQUALS(flat.size(), 3);
+    TS_ASSERT_EQUALS(flat[0], 2);
+    TS_ASSERT_EQUALS(flat[2], 1);
+    TS_ASSERT_EQUALS(table[2].size(), 2);
+  }
+
+  void testVectorFlatMapBorrowedView(void) {
+    std::vector<std::string> table {"a", "bc", "def"};
+    IntVector v {0, 1, 1};
+    Pipe<int> pipe {v};
+    std::vector<std::string> flat = pipe.flatMap<std::string>([&table](int i){
+      return StringRange {table.data() + i, table.data() + i + 2};
+    }).toVector();
+    TS_ASSERT_EQUALS(flat, std::vector<std::string>({"a", "bc", "bc", "def", "bc", "def"}));
+    TS_ASSERT_EQUALS(table, std::vector<std::string>({"a", "bc", "def"}));
+  }
+
+  void testVectorFlatMapEmitter(void) {
+    IntVector v {1, 2, 3, 4, 5};
+    Pipe<int> pipe {v};
+    Pipe<int> multiples = pipe.flatMap<int>([](int i, Emitter<int> emit){
+      for (int n {}; n!=i; n++) emit(i);
+    }, 15);
+    TS_ASSERT_EQUALS(multiples.size(), 15);
+    TS_ASSERT_EQUALS(multiples.toVector()[14], 5);
+  }
+
+  void testVectorFlatMapStrings(void) {
+    std::vector<std::string> lines {"a b", "", "c"};
+    Pipe<std::string> pipe {lines};
+    Pipe<std::string> words = pipe.flatMap<std::string>([](const std::string& line, Emitter<std::string> emit){
+      std::stringstream in {line};
+      std::string word {};
+      while (in >> word) emit(std::move(word));
+    });
+    TS_ASSERT_EQUALS(words.join(","), "a,b,c");
+  }
+
+  void testVectorSortedProperty(void) {
+    IntVector v {3, 1, 2};
+    Pipe<int> pipe {v};
+    TS_ASSERT(pipe.getProperties().order == Order::None);
+    Pipe<int> sorted = pipe.sort();
+    TS_ASSERT(sorted.getProperties().order == Order::Ascending);
+    TS_ASSERT(!sorted.getProperties().unique);
+    TS_ASSERT(sorted.contains(2));
+    TS_ASSERT(!pipe.contains(4));
+  }
+
+  void testVectorStrategiesAgree(void) {
+    IntVector v {};
+    for (int i {}; i!=100000; i++) v.push_back((i * 7919) % 1000);
+    Pipe<int> pipe {v};
+    IntVector mapped = pipe.map<int>([](int i){return i*3+1;}).toVector();
+    IntVector filtered = pipe.filter([](int i){return i%3==0;}).toVector();
+    for (Strategy strategy : {Strategy::Vectorized, Strategy::Parallel, Strategy::Adaptive}) {
+      Pipe<int> tuned = pipe.withStrategy(strategy, Parallelism {4096, 4});
+      TS_ASSERT_EQUALS(tuned.map<int>([](int i){return i*3+1;}).toVector(), mapped);
+      TS_ASSERT_EQUALS(tuned.filter([](int i){return i%3==0;}).toVector(), filtered);
+      TS_ASSERT_EQUALS(tuned.map<int>([](int i){return i*3+1;}).filter([](int i){return i%3==0;}).getContext().strategy, strategy);
+    }
+  }
+
+  void testVectorStrategyInPlace(void) {
+    IntVector v(10000, 2);
+    Pipe<int> pipe = Pipe<int> {v}.withStrategy(Strategy::Parallel, Parallelism {100, 4});
+    IntVector squared = std::move(pipe).map<int>([](int i){return i*i;}).toVector();
+    TS_ASSERT_EQUALS(squared, IntVector(10000, 4));
+  }
+
+  void testVectorStrategyNoDefault(void) {
+    std::vector<Meters> v(1000, Meters {2});
+    auto twice = [](const Meters& m){return Meters {m.value * 2};};
+    std::vector<Meters> doubled(1000, Meters {4});
+    TS_ASSERT(Pipe<Meters> {v}.map<Meters>(twice).toVector() == doubled);
+    Pipe<Meters> pipe = Pipe<Meters> {v}.withStrategy(Strategy::Parallel, Parallelism {100, 4});
+    TS_ASSERT(pipe.map<Meters>(twice).toVector() == doubled);
+    TS_ASSERT(std::move(pipe).map<Meters>(twice).toVector() == doubled);
+  }
+
+  void testVectorStrategyStrings(void) {
+    std::vector<std::string> v {};
+    for (int i {}; i!=5000; i++) v.push_back(std::to_string(i));
+    Pipe<std::string> pipe = Pipe<std::string> {v}.withStrategy(Strategy::Parallel, Parallelism {64, 4});
+    std::vector<size_t> lengths = pipe.map<size_t>([](const std::string& s){return s.size();}).toVector();
+    TS_ASSERT_EQUALS(lengths.size(), 5000);
+    TS_ASSERT_EQUALS(lengths[4999], 4);
+    TS_ASSERT_EQUALS(pipe.filter([](const std::string& s){return s.size()==1;}).join(), "0123456789");
+  }
+
+  void testVectorStrategySmallInput(void) {
+    IntVector v {1, 2, 3};
+    Pipe<int> pipe = Pipe<int> {v}.withStrategy(Strategy::Adaptive);
+    TS_ASSERT_EQUALS(pipe.map<int>([](int i){return i*2;}).toVector(), IntVector({2, 4, 6}));
+    TS_ASSERT_EQUALS(pipe.filter([](int i){return i>1;}).toVector(), IntVector({2, 3}));
+    IntVector none {};
+    TS_ASSERT(Pipe<int> {none}.withStrategy(Strategy::Adaptive).map<int>([](int i){return i;}).isEmpty());
+  }
+
+  void testCalibrationRoundTrip(void) {
+    Calibration calibration {Calibration::measure()};
+    TS_ASSERT_LESS_THAN(0, calibration.threadNanos);
+    std::string path {"pipes_calibration_test.txt"};
+    TS_ASSERT(calibration.save(path));
+    Calibration loaded {};
+    TS_ASSERT(loaded.load(path));
+    TS_ASSERT_DELTA(loaded.threadNanos, calibration.threadNanos, 1.0);
+    std::remove(path.c_str());
+  }
+
+  void testChooseStrategy(void) {
+    TS_ASSERT_EQUALS(chooseStrategy(10, 1.0, true, 8), Strategy::Vectorized);
+    TS_ASSERT_EQUALS(chooseStrategy(10, 1.0, false, 8), Strategy::Sequential);
+    TS_ASSERT_EQUALS(chooseStrategy(100000000, 100.0, true, 8), Strategy::Parallel);
+    TS_ASSERT_EQUALS(chooseStrategy(100000000, 100.0, true, 1), Strategy::Vectorized);
+  }
+
+  void testVectorCancelledBeforeStart(void) {
+    IntVector v(10000, 1);
+    CancellationToken token {};
+    token.cancel();
+    Pipe<int> pipe = Pipe<int> {v}.withCancellation(token);
+    Pipe<int> mapped = pipe.map<int>([](int i){return i*2;});
+    TS_ASSERT(mapped.isEmpty());
+    TS_ASSERT_EQUALS(mapped.getStatus(), Status::Cancelled);
+    TS_ASSERT_EQUALS(pipe.reduce(0, [](int a, int b){return a+b;}), 0);
+    TS_ASSERT_EQUALS(pipe.getStatus(), Status::Cancelled);
+  }
+
+  void testVectorCancelledMidway(void) {
+    IntVector v(10000, 1);
+    CancellationToken token {};
+    int seen {};
+    Pipe<int> pipe = Pipe<int> {v}.withCancellation(token, 100);
+    IntVector mapped = pipe.map<int>([&](int i){
+      if (++seen == 250) token.cancel();
+      return i;
+    }).toVector();
+    TS_ASSERT_EQUALS(mapped, IntVector(300, 1));
+    TS_ASSERT_EQUALS(pipe.getStatus(), Status::Cancelled);
+  }
+
+  void testVectorCancelledParallel(void) {
+    IntVector v(10000, 1);
+    CancellationToken token {};
+    token.cancel();
+    Pipe<int> pipe = Pipe<int> {v}.withCancellation(token).withStrategy(Strategy::Parallel, Parallelism {100, 4});
+    TS_ASSERT(pipe.filter([](int i){return i>0;}).isEmpty());
+    TS_ASSERT_EQUALS(pipe.getStatus(), Status::Cancelled);
+  }
+
+  void testVectorDeadline(void) {
+    IntVector v(10000, 1);
+    Pipe<int> expired = Pipe<int> {v}.withDeadline(std::chrono::steady_clock::now() - std::chrono::seconds {1});
+    TS_ASSERT_EQUALS(expired.collect(0, [](int a, int b){return a+b;}), 0);
+    TS_ASSERT_EQUALS(expired.getStatus(), Status::DeadlineExceeded);
+    Pipe<int> relaxed = Pipe<int> {v}.withTimeout(std::chrono::hours {1});
+    TS_ASSERT_EQUALS(relaxed.collect(0, [](int a, int b){return a+b;}), 10000);
+    TS_ASSERT_EQUALS(relaxed.getStatus(), Status::Completed);
+  }
+
+  void testVectorPartitionMovesOwnedSource(void) {
+    std::vector<std::string> v {"a", "bb", "ccc", "dd"};
+    auto [shortOnes, longOnes] = Pipe<std::string> {v}.partition([](const std::string& s){return s.size()<2;});
+    TS_ASSERT_EQUALS(shortOnes, std::vector<std::string>({"a"}));
+    TS_ASSERT_EQUALS(longOnes, std::vector<std::string>({"bb", "ccc", "dd"}));
+    TS_ASSERT_EQUALS(v.size(), 4);
+  }
+
+  void testVectorSelect(void) {
+    IntVector v {5, 1, 4, 2, 3};
+    Pipe<int> pipe {v};
+    Selection<int> odd = pipe.select([](int i){return i%2==1;});
+    TS_ASSERT_EQUALS(odd.getIndices(), std::vector<size_t>({0, 1, 4}));
+    TS_ASSERT_EQUALS(odd.filter([](int i){return i>1;}).toVector(), IntVector({5, 3}));
+    TS_ASSERT_EQUALS(odd.size(), 3);
+    TS_ASSERT_EQUALS(odd.map<int>([](int i){return i*10;}).toVector(), IntVector({50, 10, 30}));
+    TS_ASSERT_EQUALS(odd.collect(0, [](int z, int i){return z+i;}), 9);
+    TS_ASSERT_EQUALS(odd.find([](int i){return i<5;}), 1);
+    TS_ASSERT(!odd.exists([](int i){return i==4;}));
+    TS_ASSERT(pipe.select([](int i){return i>9;}).isEmpty());
+  }
+
+  void testVectorSelectKeepsOrder(void) {
+    IntVector v {1, 2, 3, 4};
+    Pipe<int> sorted = Pipe<int> {v}.sort();
+    Pipe<int> even = sorted.select([](int i){return i%2==0;}).toPipe();
+    TS_ASSERT_EQUALS(even.toVector(), IntVector({2, 4}));
+    TS_ASSERT_EQUALS(even.getProperties().order, Order::Ascending);
+  }
+
+  void testVectorGenericSources(void) {
+    std::deque<int> d {3, 1, 2};
+    TS_ASSERT_EQUALS(Pipe<int> {d}.toVector(), IntVector({3, 1, 2}));
+    std::list<std::string> l {"a", "b"};
+    Pipe<std::string> moved {std::move(l)};
+    TS_ASSERT_EQUALS(moved.join(), "ab");
+    TS_ASSERT(l.front().empty());
+    std::map<int,int> m {{2, 20}, {1, 10}};
+    Pipe<IntPair> entries {m};
+    TS_ASSERT_EQUALS(entries.toVector(), IntPairVector({{1, 10}, {2, 20}}));
+    TS_ASSERT_EQUALS(entries.getProperties().order, Order::Ascending);
+    std::unordered_set<int> u {4};
+    TS_ASSERT_EQUALS(Pipe<int> {u}.toVector(), IntVector({4}));
+    const IntVector c {1, 2};
+    TS_ASSERT_EQUALS(Pipe<long> {c}.sum(), 3);
+  }
+
+  void testVectorContainerSinks(void) {
+    IntVector v {3, 1, 2, 3};
+    Pipe<int> pipe {v};
+    TS_ASSERT_EQUALS(pipe.to<std::deque<int>>(), std::deque<int>({3, 1, 2, 3}));
+    TS_ASSERT_EQUALS(pipe.to<std::unordered_set<int>>().size(), 3);
+    IntVector out {0};
+    pipe.into(out);
+    TS_ASSERT_EQUALS(out, IntVector({0, 3, 1, 2, 3}));
+    std::map<int,int> m {};
+    Pipe<IntPair> {IntPairVector({{1, 2}})}.into(m);
+    TS_ASSERT_EQUALS(m[1], 2);
+    std::vector<std::string> words {"x", "y"};
+    std::list<std::string> moved = Pipe<std::string> {words}.to<std::list<std::string>>();
+    TS_ASSERT_EQUALS(moved.back(), "y");
+    TS_ASSERT_EQUALS(words.back(), "y");
+  }
+
+  void testVectorMemoryTracking(void) {
+    IntVector v(1000, 1);
+    Pipe<int> pipe = Pipe<int> {v}.withMemoryBudget(1 << 20);
+    std::shared_ptr<MemoryTracker> tracker {pipe.getMemoryTracker()};
+    {
+      Pipe<int> doubled = pipe.map<int>([](int i){return i*2;});
+      TS_ASSERT_EQUALS(tracker->current(), 1000 * sizeof(int));
+      Pipe<long> widened = doubled.map<long>([](int i){return long {i};});
+      TS_ASSERT_EQUALS(tracker->current(), 1000 * (sizeof(int) + sizeof(long)));
+      TS_ASSERT_EQUALS(widened.getMemoryTracker(), tracker);
+    }
+    TS_ASSERT_EQUALS(tracker->current(), 0);
+    TS_ASSERT_EQUALS(tracker->peak(), 1000 * (sizeof(int) + sizeof(long)));
+    TS_ASSERT_EQUALS(pipe.filter([](int i){return i>0;}).size(), 1000);
+    TS_ASSERT_EQUALS(tracker->current(), 0);
+  }
+
+  void testVectorMemoryBudgetExceeded(void) {
+    IntVector v(1000, 1);
+    Pipe<int> pipe = Pipe<int> {v}.withMemoryBudget(1000 * sizeof(int) + 10);
+    Pipe<int> first = pipe.map<int>([](int i){return i+1;});
+    TS_ASSERT_THROWS(first.map<int>([](int i){return i+1;}), MemoryBudgetExceeded);
+    TS_ASSERT_EQUALS(pipe.getMemoryTracker()->current(), 1000 * sizeof(int));
+    TS_ASSERT_EQUALS(first.take(2).toVector(), IntVector({2, 2}));
+  }
+
+  void testVectorMemoryChargedUpFront(void) {
+    IntVector v(1000, 1);
+    Pipe<int> pipe = Pipe<int> {v}.withMemoryBudget(100);
+    std::shared_ptr<MemoryTracker> tracker {pipe.getMemoryTracker()};
+    size_t calls {};
+    TS_ASSERT_THROWS(pipe.map<int>([&](int i){calls++; return i;}), MemoryBudgetExceeded);
+    TS_ASSERT_EQUALS(calls, 0);
+    TS_ASSERT_THROWS(pipe.groupBy<int>([](int i){return i;}), MemoryBudgetExceeded);
+    TS_ASSERT_THROWS(pipe.partition([](int i){return i>0;}), MemoryBudgetExceeded);
+    TS_ASSERT_THROWS(pipe.select([](int i){return i>0;}), MemoryBudgetExceeded);
+    TS_ASSERT_EQUALS(tracker->current(), 0);
+    TS_ASSERT_EQUALS(tracker->peak(), 0);
+  }
+
+  void testVectorMemorySetOperations(void) {
+    IntVector v {};
+    for (int i {}; i!=1000; i++) v.push_back(i % 10);
+    IntVector w {5, 50};
+    Pipe<int> pipe = Pipe<int> {v}.withMemoryBudget(8000);
+    std::shared_ptr<MemoryTracker> tracker {pipe.getMemoryTracker()};
+    Pipe<int> other = Pipe<int> {w}.withMemoryBudget(1 << 20);
+    TS_ASSERT_THROWS(pipe.distinct(), MemoryBudgetExceeded);
+    TS_ASSERT_THROWS(pipe.distinctBy<int>([](int i){return i;}), MemoryBudgetExceeded);
+    TS_ASSERT_THROWS(pipe.unionWith(other), MemoryBudgetExceeded);
+    TS_ASSERT_THROWS(pipe.intersect(other), MemoryBudgetExceeded);
+    TS_ASSERT_THROWS(pipe.except(other), MemoryBudgetExceeded);
+    TS_ASSERT_EQUALS(tracker->current(), 0);
+    Pipe<int> roomy = pipe.withMemoryBudget(1 << 20);
+    tracker = roomy.getMemoryTracker();
+    TS_ASSERT_EQUALS(roomy.distinct().size(), 10);
+    TS_ASSERT_EQUALS(tracker->current(), 0);
+    TS_ASSERT_LESS_THAN_EQUALS(FlatIndexSet::bytesFor(1000) + 1000 * sizeof(int), tracker->peak());
+  }
+
+  void testVectorMemorySelection(void) {
+    IntVector v {1, 2, 3, 4};
+    Pipe<int> pipe = Pipe<int> {v}.withMemoryBudget(1 << 20);
+    std::shared_ptr<MemoryTracker> tracker {pipe.getMemoryTracker()};
+    {
+      Selection<int> even = pipe.select([](int i){return i%2==0;});
+      TS_ASSERT_LESS_THAN(0, tracker->current());
+      TS_ASSERT_LESS_THAN_EQUALS(tracker->current(), 4 * sizeof(size_t));
+      size_t held {tracker->current()};
+      Selection<int> copy {even};
+      TS_ASSERT_EQUALS(tracker->current(), 2 * held);
+    }
+    TS_ASSERT_EQUALS(tracker->current(), 0);
+    pipe.groupBy<int>([](int i){return i%2;});
+    TS_ASSERT_EQUALS(tracker->current(), 0);
+    TS_ASSERT_LESS_THAN_EQUALS(4 * sizeof(int), tracker->peak());
+  }
+
+  void testVectorDistinct(void) {
+    IntVector v {3, 1, 3, 2, 1};
+    Pipe<int> pipe {v};
+    Pipe<int> distinct = pipe.distinct();
+    TS_ASSERT_EQUALS(distinct.toVector(), IntVector({3, 1, 2}));
+    TS_ASSERT(distinct.getProperties().unique);
+    Pipe<int> sorted = pipe.sort().distinct();
+    TS_ASSERT_EQUALS(sorted.toVector(), IntVector({1, 2, 3}));
+    TS_ASSERT_EQUALS(sorted.getProperties().order, Order::Ascending);
+    TS_ASSERT_EQUALS(pipe.sort(std::greater<int> {}).distinct().toVector(), IntVector({3, 2, 1}));
+    IntVector many {};
+    for (int i {}; i!=10000; i++) many.push_back(i % 997);
+    TS_ASSERT_EQUALS(Pipe<int> {many}.distinct().size(), 997);
+  }
+
+  void testVectorDistinctBy(void) {
+    std::vector<std::string> v {"apple", "avocado", "banana", "blueberry", "cherry"};
+    Pipe<std::string> pipe {v};
+    Pipe<std::string> firsts = pipe.distinctBy<char>([](const std::string& s){return s[0];});
+    TS_ASSERT_EQUALS(firsts.toVector(), std::vector<std::string>({"apple", "banana", "cherry"}));
+  }
+
+  void testVectorSetOperations(void) {
+    IntVector a {5, 1, 3, 1, 7};
+    IntVector b {3, 9, 5, 5};
+    Pipe<int> left {a};
+    Pipe<int> right {b};
+    TS_ASSERT_EQUALS(left.unionWith(right).toVector(), IntVector({5, 1, 3, 7, 9}));
+    TS_ASSERT_EQUALS(left.intersect(right).toVector(), IntVector({5, 3}));
+    TS_ASSERT_EQUALS(left.except(right).toVector(), IntVector({1, 7}));
+  }
+
+  void testVectorSortedSetOperations(void) {
+    IntVector a {1, 1, 3, 5, 7};
+    IntVector b {3, 5, 5, 9};
+    Pipe<int> left = Pipe<int> {a}.sort();
+    Pipe<int> right = Pipe<int> {b}.sort();
+    TS_ASSERT_EQUALS(left.unionWith(right).toVector(), IntVector({1, 3, 5, 7, 9}));
+    TS_ASSERT_EQUALS(left.intersect(right).toVector(), IntVector({3, 5}));
+    TS_ASSERT_EQUALS(left.except(right).toVector(), IntVector({1, 7}));
+    TS_ASSERT_EQUALS(left.except(right).getProperties().order, Order::Ascending);
+    Pipe<int> down = left.reverse();
+    TS_ASSERT_EQUALS(down.intersect(right.reverse()).toVector(), IntVector({5, 3}));
+    TS_ASSERT_EQUALS(down.except(right).toVector(), IntVector({7, 1}));
+  }
+
+  void testVectorPartitionCancelled(void) {
+    IntVector v {};
+    for (int i {}; i!=100; i++) v.push_back(i);
+    CancellationToken token {};
+    int seen {};
+    Pipe<int> pipe = Pipe<int> {v}.withCancellation(token, 10);
+    auto [small, large] = pipe.partition([&](int i){
+      if (++seen == 15) token.cancel();
+      return i < 5;
+    });
+    TS_ASSERT_EQUALS(small, IntVector({0, 1, 2, 3, 4}));
+    TS_ASSERT_EQUALS(large.size(), 15);
+    TS_ASSERT_EQUALS(large.back(), 19);
+    TS_ASSERT_EQUALS(pipe.getStatus(), Status::Cancelled);
+  }
+
+  void testVectorSourcePropertiesExactElements(void) {
+    std::multimap<int,char> m {{1, 'b'}, {1, 'a'}};
+    Pipe<std::pair<int,char>> entries {m};
+    TS_ASSERT_EQUALS(entries.getProperties().order, Order::None);
+    TS_ASSERT_EQUALS(entries.min(), std::make_pair(1, 'a'));
+    TS_ASSERT(entries.contains({1, 'a'}));
+    std::set<double> d {1.2, 1.7, 2.5};
+    Pipe<int> truncated {d};
+    TS_ASSERT(!truncated.getProperties().unique);
+    TS_ASSERT_EQUALS(truncated.distinct().size(), 2);
+    std::multiset<int> ms {2, 1, 2};
+    TS_ASSERT_EQUALS(Pipe<int> {ms}.getProperties().order, Order::Ascending);
+  }
+
+  void testVectorSourceImplicitConversions(void) {
+    static_assert(!std::is_constructible_v<Pipe<IntVector>, IntVector>);
+    static_assert(!std::is_constructible_v<Pipe<int>, std::string>);
+    static_assert(std::is_constructible_v<Pipe<char>, std::string>);
+    const IntVector v {3, 1, 2};
+    Pipe<int> copied {v};
+    TS_ASSERT_EQUALS(copied.toVector(), v);
+    std::deque<int> d {3, 1};
+    TS_ASSERT_EQUALS(Pipe<long> {d}.toVector(), std::vector<long>({3, 1}));
+    TS_ASSERT_EQUALS(Pipe<char> {std::string {"ab"}}.size(), 2);
+  }
 };